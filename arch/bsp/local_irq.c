@@ -0,0 +1,25 @@
+#include <arch/bsp/local_irq.h>
+
+#define MAILBOX0_IRQ (1u << 0)
+
+static volatile struct local_irq_controller *local_irq_regs(void)
+{
+	return (volatile struct local_irq_controller *)LOCAL_IRQ_BASE;
+}
+
+void local_irq_enable_mailbox(unsigned int core)
+{
+	local_irq_regs()->mailbox_irq_control[core] = MAILBOX0_IRQ;
+}
+
+void local_irq_mailbox_write(unsigned int core, unsigned int mailbox, unsigned int bits)
+{
+	local_irq_regs()->mailbox_set[core][mailbox] = bits;
+}
+
+unsigned int local_irq_mailbox_take(unsigned int core, unsigned int mailbox)
+{
+	unsigned int bits = local_irq_regs()->mailbox_clear[core][mailbox];
+	local_irq_regs()->mailbox_clear[core][mailbox] = bits;
+	return bits;
+}
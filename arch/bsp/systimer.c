@@ -16,27 +16,64 @@ void systimer_clear_match(unsigned int timer)
 	systimer->cs = (1u << timer);
 }
 
-void systimer_increment_compare(unsigned int timer, unsigned int interval)
+unsigned int systimer_now(void)
+{
+	return systimer->clo;
+}
+
+unsigned long long systimer_now64(void)
+{
+	// chi kann zwischen den Lesezugriffen überlaufen, dann clo neu lesen
+	unsigned int hi = systimer->chi;
+	unsigned int lo = systimer->clo;
+	if (systimer->chi != hi) {
+		hi = systimer->chi;
+		lo = systimer->clo;
+	}
+	return ((unsigned long long)hi << 32) | lo;
+}
+
+void systimer_set_compare(unsigned int timer, unsigned int value)
 {
 	if (!systimer_valid_channel(timer)) {
 		return;
 	}
 
-	unsigned int now = systimer->clo;
 	switch (timer) {
 	case 0:
-		systimer->c0 = now + interval;
+		systimer->c0 = value;
 		return;
 	case 1:
-		systimer->c1 = now + interval;
+		systimer->c1 = value;
 		return;
 	case 2:
-		systimer->c2 = now + interval;
+		systimer->c2 = value;
 		return;
 	case 3:
-		systimer->c3 = now + interval;
+		systimer->c3 = value;
 		return;
 	default:
 		return; 
 	}
 }
+
+unsigned int systimer_get_compare(unsigned int timer)
+{
+	switch (timer) {
+	case 0:
+		return systimer->c0;
+	case 1:
+		return systimer->c1;
+	case 2:
+		return systimer->c2;
+	case 3:
+		return systimer->c3;
+	default:
+		return 0u;
+	}
+}
+
+void systimer_increment_compare(unsigned int timer, unsigned int interval)
+{
+	systimer_set_compare(timer, systimer->clo + interval);
+}
@@ -4,10 +4,65 @@
 #include <lib/ringbuffer.h>
 
 #include <config.h>
+#include <syscall.h>
+
+#include <stddef.h>
 
 volatile struct uart *const uart = (struct uart *)UART_BASE;
 
-create_ringbuffer(uart_rx_buffer, UART_INPUT_BUFFER_SIZE);
+/*
+ * Der RX Ringbuffer liegt mit seinen Daten in einer eigenen Seite, die User
+ * Threads über syscall_rx_ring() lesen. Nur tail schreiben sie zurück, siehe
+ * struct rx_ring in syscall.h. Ohne MMU ist "nur lesen" eine Abmachung, der
+ * Kernel rechnet deshalb mit seiner eigenen Kopie uart_rx_state: head, mask
+ * und buffer kommen nie aus der Seite, tail nur über uart_rx().
+ */
+static_assert(is_power_of_two(UART_INPUT_BUFFER_SIZE), "Size of Ringbuffer has to be a power of 2");
+
+static struct {
+	struct rx_ring ring;
+	char	       data[UART_INPUT_BUFFER_SIZE];
+} uart_rx_page __attribute__((aligned(4096))) = {
+	{ 0, 0, UART_INPUT_BUFFER_SIZE, UART_INPUT_BUFFER_SIZE - 1, uart_rx_page.data },
+	{ 0 },
+};
+static struct ring_buff uart_rx_state = {
+	0, 0, UART_INPUT_BUFFER_SIZE, UART_INPUT_BUFFER_SIZE - 1, uart_rx_page.data,
+};
+static volatile struct ring_buff *uart_rx_buffer = &uart_rx_state;
+
+/*
+ * Übernimmt tail aus der Seite. Es wird genau einmal gelesen und nur
+ * angenommen, wenn es zwischen dem bisherigen tail und head liegt. So bleibt
+ * head - tail <= size, egal was ein Thread hineinschreibt.
+ */
+static volatile struct ring_buff *uart_rx(void)
+{
+	unsigned int tail = uart_rx_page.ring.tail;
+	if (tail - uart_rx_buffer->tail <= uart_rx_buffer->head - uart_rx_buffer->tail) {
+		uart_rx_buffer->tail = tail;
+	}
+	return uart_rx_buffer;
+}
+
+// head erst nach den Daten sichtbar machen, rx_ring_peek auf einem anderen Kern paart damit
+static void uart_rx_publish_head(void)
+{
+	__asm__ volatile("dmb" ::: "memory");
+	uart_rx_page.ring.head = uart_rx_buffer->head;
+}
+
+static void uart_rx_publish_tail(void)
+{
+	uart_rx_page.ring.tail = uart_rx_buffer->tail;
+}
+
+// Ausgabepuffer für syscall_write, Zweierpotenz wie beim RX Ringbuffer
+#define UART_OUTPUT_BUFFER_SIZE 512u
+
+create_ringbuffer(uart_tx_buffer, UART_OUTPUT_BUFFER_SIZE);
+
+#define UART_INT_TX (1u << 5)
 
 void uart_init(void)
 {
@@ -27,14 +82,15 @@ void uart_init(void)
 	uart->cr |= 1u; 
 }
 
+// RX Level und RX Timeout, damit auch kurze Eingaben ohne volles Level ankommen
 void uart_enable_rx_interrupt(void)
 {
-	uart->imsc |= (1u << 4);
+	uart->imsc |= (1u << 4) | (1u << 6);
 }
 
 unsigned int uart_get_rx_interrupt_status(void)
 {
-	return (uart->mis >> 4) & 0x1u;
+	return ((uart->mis >> 4) | (uart->mis >> 6)) & 0x1u;
 }
 
 void uart_clear_interrupt(void)
@@ -44,17 +100,19 @@ void uart_clear_interrupt(void)
 
 void uart_rx_into_buffer(void)
 {
+	volatile struct ring_buff *rx = uart_rx();
 	while (!(uart->fr & (1u << 4))) {
-		if (buff_is_full(uart_rx_buffer)) {
+		if (buff_is_full(rx)) {
 			break;
 		}
 		char c = (char)(uart->dr & 0xFF);
-		buff_putc(uart_rx_buffer, c);
+		buff_putc(rx, c);
 	}
+	uart_rx_publish_head();
 }
 
 bool uart_rx_data_available_and_buffer_not_full(void){
-	return !(uart->fr & (1u << 4)) && !buff_is_full(uart_rx_buffer);
+	return !(uart->fr & (1u << 4)) && !buff_is_full(uart_rx());
 }
 
 char uart_rx_get_char(void) {
@@ -63,18 +121,75 @@ char uart_rx_get_char(void) {
 
 char uart_getc(void)
 {
-	while (buff_is_empty(uart_rx_buffer)) {
+	volatile struct ring_buff *rx = uart_rx();
+	while (buff_is_empty(rx)) {
 		if (!(uart->fr & (1u << 4))) {
-			buff_putc(uart_rx_buffer, (char)(uart->dr & 0xFF));
+			buff_putc(rx, (char)(uart->dr & 0xFF));
 			break;
 		}
 	}
-	return buff_getc(uart_rx_buffer);
+	char c = buff_getc(rx);
+	uart_rx_publish_head();
+	uart_rx_publish_tail();
+	return c;
+}
+
+bool uart_tx_full(void)
+{
+	return (uart->fr & (1u << 5)) != 0u;
+}
+
+unsigned int uart_get_tx_interrupt_status(void)
+{
+	return (uart->mis >> 5) & 0x1u;
+}
+
+/*
+ * Schiebt den TX Ringbuffer in die FIFO. Der TX Interrupt kommt erst, wenn die
+ * FIFO unter ihr Level fällt, deshalb ist er nur an solange der Buffer etwas hält.
+ */
+void uart_tx_from_buffer(void)
+{
+	while (!buff_is_empty(uart_tx_buffer) && !uart_tx_full()) {
+		uart->dr = (unsigned int)buff_getc(uart_tx_buffer);
+	}
+
+	if (buff_is_empty(uart_tx_buffer)) {
+		uart->imsc &= ~UART_INT_TX;
+		uart->icr = UART_INT_TX;
+	}
+}
+
+/*
+ * Gibt so viel von buf aus wie FIFO und TX Ringbuffer aufnehmen, ohne zu warten.
+ * Liefert die Anzahl übernommener Zeichen.
+ */
+size_t uart_write_nonblocking(const char *buf, size_t len)
+{
+	uart_tx_from_buffer();
+
+	size_t done = 0;
+	// Ist der Buffer leer, direkt in die FIFO, sonst hinten anstellen
+	while (done < len && buff_is_empty(uart_tx_buffer) && !uart_tx_full()) {
+		uart->dr = (unsigned int)buf[done++];
+	}
+	while (done < len && !buff_is_full(uart_tx_buffer)) {
+		buff_putc(uart_tx_buffer, buf[done++]);
+	}
+
+	if (!buff_is_empty(uart_tx_buffer)) {
+		uart->imsc |= UART_INT_TX;
+	}
+	return done;
 }
 
 void uart_putc(char c)
 {
-	while (uart->fr & (1u << 5)) {
+	// Nur noch für kprintf. Gepufferte Ausgabe zuerst, sonst überholt kprintf sie
+	while (!buff_is_empty(uart_tx_buffer)) {
+		uart_tx_from_buffer();
+	}
+	while (uart_tx_full()) {
 		/* TX FIFO full, keep waiting */
 	}
 	uart->dr = (unsigned int)c;
@@ -97,34 +212,57 @@ bool uart_getc_nonblocking(char *out)
 		return false;
 	}
 
-	if (buff_is_empty(uart_rx_buffer)) {
+	volatile struct ring_buff *rx = uart_rx();
+	if (buff_is_empty(rx)) {
 		return false;
 	}
 
-	*out = buff_getc(uart_rx_buffer);
+	*out = buff_getc(rx);
+	uart_rx_publish_tail();
 	return true;
 }
 
+// Holt bis zu len Zeichen aus dem RX Ringbuffer, ohne zu warten
+size_t uart_read_nonblocking(char *buf, size_t len)
+{
+	volatile struct ring_buff *rx = uart_rx();
+	size_t done = 0;
+	while (done < len && !buff_is_empty(rx)) {
+		buf[done++] = buff_getc(rx);
+	}
+	uart_rx_publish_tail();
+	return done;
+}
+
 bool uart_peekc(char *out)
 {
 	if (!out) {
 		return false;
 	}
 
-	if (buff_is_empty(uart_rx_buffer)) {
+	volatile struct ring_buff *rx = uart_rx();
+	if (buff_is_empty(rx)) {
 		return false;
 	}
 
-	*out = uart_rx_buffer->buffer[uart_rx_buffer->tail & uart_rx_buffer->mask];
+	*out = rx->buffer[rx->tail & rx->mask];
 	return true;
 }
 
+/*
+ * Wie buff_putc, aber das Zeichen muss für einen Leser auf einem anderen Kern
+ * sichtbar sein, bevor head es freigibt.
+ */
 bool uart_buffer_putc(char c)
 {
-	if (buff_is_full(uart_rx_buffer)) {
+	if (buff_putc(uart_rx(), c)) {
 		return false;
 	}
-
-	buff_putc(uart_rx_buffer, c);
+	uart_rx_publish_head();
 	return true;
+}
+
+struct rx_ring *uart_rx_ring(void)
+{
+	return &uart_rx_page.ring;
 }
\ No newline at end of file
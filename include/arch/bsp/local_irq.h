@@ -0,0 +1,36 @@
+#ifndef LOCAL_IRQ_H
+#define LOCAL_IRQ_H
+
+/* BCM2836 ARM control block, liegt außerhalb des Peripheriefensters */
+#define LOCAL_IRQ_BASE 0x40000000u
+
+struct local_irq_controller {
+	unsigned int control;
+	unsigned int unused0;
+	unsigned int core_timer_prescaler;
+	unsigned int gpu_irq_routing;
+	unsigned int pmu_irq_set;
+	unsigned int pmu_irq_clear;
+	unsigned int unused1;
+	unsigned int core_timer_low;
+	unsigned int core_timer_high;
+	unsigned int local_irq_routing;
+	unsigned int unused2[2];
+	unsigned int axi_counters;
+	unsigned int local_timer_control;
+	unsigned int local_timer_reload;
+	unsigned int unused3;
+	unsigned int core_timer_irq_control[4];
+	unsigned int mailbox_irq_control[4];
+	unsigned int irq_source[4];
+	unsigned int fiq_source[4];
+	unsigned int mailbox_set[4][4];
+	unsigned int mailbox_clear[4][4];
+};
+
+void local_irq_enable_mailbox(unsigned int core);
+
+void local_irq_mailbox_write(unsigned int core, unsigned int mailbox, unsigned int bits);
+unsigned int local_irq_mailbox_take(unsigned int core, unsigned int mailbox);
+
+#endif
@@ -19,4 +19,12 @@ void systimer_clear_match(unsigned int timer);
 
 void systimer_increment_compare(unsigned int timer, unsigned int interval); 
 
+void systimer_set_compare(unsigned int timer, unsigned int value);
+
+unsigned int systimer_get_compare(unsigned int timer);
+
+unsigned int systimer_now(void);
+
+unsigned long long systimer_now64(void);
+
 #endif
@@ -2,6 +2,7 @@
 #define UART_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #define UART_BASE (0x7E201000u - 0x3F000000u)
 
@@ -30,13 +31,19 @@ struct uart {
 
 extern volatile struct uart *const uart;
 
+struct rx_ring;
+
 void uart_init(void);
 char uart_getc(void);
 void uart_putc(char c);
+bool uart_tx_full(void);
+size_t uart_write_nonblocking(const char *buf, size_t len);
 void uart_puts(const char *str);
 bool uart_getc_nonblocking(char *out);
+size_t uart_read_nonblocking(char *buf, size_t len);
 bool uart_peekc(char *out);
 bool uart_buffer_putc(char c);
+struct rx_ring *uart_rx_ring(void);
 bool uart_rx_data_available_and_buffer_not_full(void);
 char uart_rx_get_char(void);
 
@@ -44,5 +51,7 @@ void	     uart_enable_rx_interrupt(void);
 unsigned int uart_get_rx_interrupt_status(void);
 void	     uart_clear_interrupt(void);
 void	     uart_rx_into_buffer(void);
+unsigned int uart_get_tx_interrupt_status(void);
+void	     uart_tx_from_buffer(void);
 
 #endif
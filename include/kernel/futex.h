@@ -0,0 +1,24 @@
+#ifndef FUTEX_H_
+#define FUTEX_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Futex wait queues keyed by user address. Waiters of all addresses that hash
+ * to the same bucket share its queue, futex_wake picks out the matching ones.
+ */
+#define FUTEX_HASH_BITS 5u
+
+typedef enum {
+	FUTEX_INVALID = 0,
+	FUTEX_AGAIN,
+	FUTEX_BLOCKED,
+} futex_result_t;
+
+void	       futex_init(void);
+futex_result_t futex_wait(uint32_t addr, uint32_t expected);
+uint32_t       futex_wake(uint32_t addr, uint32_t count);
+bool	       futex_cmpxchg(uint32_t addr, uint32_t old, uint32_t val, uint32_t *prev);
+
+#endif // FUTEX_H_
@@ -6,8 +6,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-void irq_handler(context_frame_t *ctx);
-void svc_handler(context_frame_t *ctx);
+void irq_handler(context_frame_t *ctx, uint32_t entry_cycles);
+void svc_handler(context_frame_t *ctx, uint32_t entry_cycles);
 void undefined_handler(context_frame_t *ctx);
 void prefetch_abort_handler(context_frame_t *ctx);
 void data_abort_handler(context_frame_t *ctx);
@@ -0,0 +1,23 @@
+#ifndef HRTIMER_H_
+#define HRTIMER_H_
+
+#include <stdint.h>
+
+/*
+ * Microsecond sleeps on systimer channel HRTIMER_CHANNEL, independent of the
+ * scheduling tick. The channel is programmed one-shot for the earliest
+ * deadline and only enabled while somebody sleeps.
+ */
+#define HRTIMER_CHANNEL 2u
+
+typedef enum {
+	HRTIMER_INVALID = 0,
+	HRTIMER_DONE,
+	HRTIMER_BLOCKED,
+} hrtimer_result_t;
+
+void		 hrtimer_init(void);
+hrtimer_result_t hrtimer_sleep_until(uint64_t deadline_us);
+void		 hrtimer_expire(void);
+
+#endif // HRTIMER_H_
@@ -0,0 +1,28 @@
+#ifndef IPC_H_
+#define IPC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <syscall.h>
+
+/*
+ * IPC ports: fixed size messages queued by value, IPC_PORT_DEPTH per port.
+ * Receivers and senders hitting a full queue wait in FIFO order.
+ */
+#define IPC_PORT_MAX   8u
+#define IPC_PORT_DEPTH 16u
+
+typedef enum {
+	IPC_INVALID = 0,
+	IPC_DONE,
+	IPC_BLOCKED,
+} ipc_result_t;
+
+void	     ipc_init(void);
+uint32_t     ipc_port_create(void);
+ipc_result_t ipc_send(uint32_t id, const struct ipc_msg *msg);
+ipc_result_t ipc_receive(uint32_t id, struct ipc_msg *out);
+bool	     ipc_port_readable(uint32_t id, bool *readable);
+
+#endif // IPC_H_
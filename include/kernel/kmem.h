@@ -0,0 +1,32 @@
+#ifndef KMEM_H_
+#define KMEM_H_
+
+/*
+ * Size of the pool behind kmem_alloc(), reserved in stacks.S. Thread control
+ * blocks, thread stacks, VFP banks and poll tables live there. A thread costs
+ * 1.25 KiB for its TCB (including the kernel stack) plus its stack class, and
+ * 512 bytes more once it uses VFP. The default holds the 32 threads with 2 KiB
+ * stacks the fixed stack array used to, and then some. Build with
+ * -DKMEM_POOL_SIZE=... to change it, it must be a multiple of 256.
+ */
+#ifndef KMEM_POOL_SIZE
+#define KMEM_POOL_SIZE (128u << 10)
+#endif
+
+// Kleinste und größte Blockgröße, passend zu THREAD_STACK_MIN/MAX in syscall.h
+#define KMEM_MIN_BLOCK 256u
+#define KMEM_MAX_BLOCK 16384u
+
+#ifndef __ASSEMBLER__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+void   kmem_init(void);
+void  *kmem_alloc(size_t size);
+void   kmem_free(void *ptr, size_t size);
+size_t kmem_block_size(size_t size);
+bool   kmem_scrub(void);
+
+#endif // __ASSEMBLER__
+#endif // KMEM_H_
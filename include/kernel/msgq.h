@@ -0,0 +1,35 @@
+#ifndef MSGQ_H_
+#define MSGQ_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <lib/list.h>
+
+/*
+ * Bounded FIFO of fixed size entries with two wait lists, the base of IPC
+ * ports and work queues. Receivers wait on receivers while the queue is
+ * empty, senders on senders while it is full. The entries live in storage
+ * the owner passes to msgq_init(), queues are handed out by id from a fixed
+ * array, id i + 1 names queues[i].
+ */
+typedef struct msgq {
+	bool	  used;
+	uint32_t  head;
+	uint32_t  count;
+	uint32_t  depth;
+	size_t	  entry_size;
+	uint8_t	 *entries;
+	list_node receivers;
+	list_node senders;
+} msgq_t;
+
+void	 msgq_init(msgq_t *q, void *entries, size_t entry_size, uint32_t depth);
+uint32_t msgq_create(msgq_t *queues, unsigned int n);
+msgq_t	*msgq_get(msgq_t *queues, unsigned int n, uint32_t id);
+bool	 msgq_full(const msgq_t *q);
+void	 msgq_push(msgq_t *q, const void *entry);
+void	 msgq_pop(msgq_t *q, void *out);
+
+#endif // MSGQ_H_
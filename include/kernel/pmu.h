@@ -0,0 +1,28 @@
+#ifndef PMU_H_
+#define PMU_H_
+
+#include <stdint.h>
+
+/*
+ * Zyklenzähler der PMU (PMCCNTR), jeder Kern hat seinen eigenen. Unter QEMU
+ * mit -icount zählt er deterministisch, die Messpunkte in scheduler_stats_t
+ * lassen sich so zwischen zwei Ständen des Kernels vergleichen.
+ */
+static inline void pmu_init(void)
+{
+	uint32_t pmcr;
+	__asm__ volatile("mrc p15, 0, %0, c9, c12, 0" : "=r"(pmcr));
+	// E: Zähler an, C: PMCCNTR auf 0
+	__asm__ volatile("mcr p15, 0, %0, c9, c12, 0" ::"r"(pmcr | 0x5u));
+	// PMCNTENSET.C
+	__asm__ volatile("mcr p15, 0, %0, c9, c12, 1" ::"r"(1u << 31));
+}
+
+static inline uint32_t pmu_cycles(void)
+{
+	uint32_t cycles;
+	__asm__ volatile("mrc p15, 0, %0, c9, c13, 0" : "=r"(cycles));
+	return cycles;
+}
+
+#endif // PMU_H_
@@ -0,0 +1,27 @@
+#ifndef POLL_H_
+#define POLL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <syscall.h>
+
+/*
+ * Wait for several events at once. Every event source has a poll queue, a
+ * polling thread puts one entry on each queue it waits for and so sits on
+ * several at once. Sources call poll_notify() when they might have become
+ * ready, timeouts are checked by poll_tick().
+ */
+typedef enum {
+	POLL_INVALID = 0,
+	POLL_DONE,
+	POLL_BLOCKED,
+} poll_result_t;
+
+void	      poll_init(void);
+poll_result_t poll_wait(struct poll_event *events, uint32_t count, uint32_t *ready);
+void	      poll_notify(uint32_t type, uint32_t arg);
+void	      poll_tick(void);
+bool	      poll_next_deadline(uint32_t *tick);
+
+#endif // POLL_H_
@@ -1,10 +1,50 @@
 #ifndef SCHEDULER_H_
 #define SCHEDULER_H_
 
-#define MAX_THREADS 32
+/*
+ * Thread control blocks and stacks come from kmem, see kernel/kmem.c.
+ * MAX_THREADS only bounds the slot table (and the slot bitmap, which holds at
+ * most 1024 bits). STACK_SIZE is the stack of threads created without an
+ * explicit size.
+ */
+#define MAX_THREADS 1024
 #define STACK_SIZE  2048
 #define CTX_FRAME_SIZE  (17 * 4)
 
+/*
+ * Every thread has its own kernel stack directly below its ctx_storage.
+ * Exceptions from user mode start on an empty kernel stack, so their frame is
+ * exactly ctx_storage.
+ */
+#define KERNEL_STACK_SIZE 1024
+
+/*
+ * Tickless idle: while only the idle thread runs, the tick is stopped and the
+ * timer is programmed for the earliest sleeper instead. Build with
+ * -DSCHED_TICKLESS=0 to keep the periodic tick at all times.
+ */
+#ifndef SCHED_TICKLESS
+#define SCHED_TICKLESS 1
+#endif
+
+/*
+ * Scheduling policy, selected at build time with -DSCHED_POLICY=...
+ * PRIORITY: strict static priorities, round-robin every tick inside a level.
+ * MLFQ: like PRIORITY, but threads that use up their quantum sink below their
+ * base priority and threads that block rise again, see kernel/scheduler.c.
+ * FAIR: always run the thread with the least weighted CPU time (vruntime),
+ * the priority only selects the weight.
+ */
+#define SCHED_POLICY_PRIORITY 0
+#define SCHED_POLICY_MLFQ     1
+#define SCHED_POLICY_FAIR     2
+
+#ifndef SCHED_POLICY
+#define SCHED_POLICY SCHED_POLICY_PRIORITY
+#endif
+
+#include <kernel/smp.h>
+
 #ifndef __ASSEMBLER__
 
 #include <stdbool.h>
@@ -12,14 +52,24 @@
 #include <stddef.h>
 
 #include <lib/list.h>
+#include <kernel/vfp.h>
 
 typedef enum {
     T_UNUSED = 0,
     T_RUNNING,
     T_SLEEPING,
     T_WAITING_IO,
+    T_RT_WAITING,
+    T_JOINING,
+    T_BLOCKED,
 } thread_state_t;
 
+typedef enum {
+    JOIN_INVALID = 0,
+    JOIN_EXITED,
+    JOIN_BLOCKED,
+} join_result_t;
+
 typedef struct context_frame {
     uint32_t r0;
     uint32_t r1;
@@ -34,33 +84,109 @@ typedef struct context_frame {
     uint32_t r10;
     uint32_t r11;
     uint32_t r12;
-    uint32_t lr_usr;
     uint32_t sp_usr;
+    uint32_t lr_usr;
     uint32_t lr_exc;
     uint32_t cpsr_usr;
 } context_frame_t;
 
+/* Callee-saved state of a thread switched out inside the kernel, see cpu_switch_to. */
+typedef struct kernel_context {
+    uint32_t r4;
+    uint32_t r5;
+    uint32_t r6;
+    uint32_t r7;
+    uint32_t r8;
+    uint32_t r9;
+    uint32_t r10;
+    uint32_t r11;
+    uint32_t sp;
+    uint32_t lr;
+} kernel_context_t;
+
 typedef struct tcb {
+    uint8_t            kernel_stack[KERNEL_STACK_SIZE];
     context_frame_t    ctx_storage;
-    thread_state_t     state;
+    kernel_context_t   kctx;
     uint8_t*           stack_base;
     uint8_t*           stack_top;
-    uint32_t           sleep_ticks;
-    list_node          wait_node;
+    unsigned int       slot;
+    list_node          joiners;
+    uint64_t           runtime_us;
+    uint32_t           dispatched_at;
+    vfp_state_t*       vfp;
 } tcb_t;
 
-extern tcb_t* g_current;
+/*
+ * The *_cycles fields are PMU cycle counts, see include/kernel/pmu.h. svc
+ * covers a syscall that returns without a switch, from the vector right after
+ * the register save to the end of svc_handler. tick_switch runs from the tick
+ * IRQ vector until the next thread resumes on that core.
+ */
+typedef struct scheduler_stats {
+    uint32_t ticks;
+    uint32_t sleep_queue_visits;
+    uint32_t tick_stops;
+    uint32_t rt_deadline_misses;
+    uint32_t rt_budget_overruns;
+    uint32_t steals;
+    uint32_t irq_latency_max_us;
+    uint32_t wakeups;
+    uint32_t wakeup_latency_last_us;
+    uint32_t wakeup_latency_max_us;
+    uint32_t svc_cycles_last;
+    uint32_t svc_cycles_max;
+    uint32_t tick_switch_cycles_last;
+    uint32_t tick_switch_cycles_max;
+} scheduler_stats_t;
+
+/* Thread running on the calling core. */
+extern tcb_t* g_current_cpu[SMP_CORES];
+#define g_current (g_current_cpu[smp_cpu_id()])
 
-extern void scheduler_first_context_restore(context_frame_t *ctx);
+extern void cpu_switch_to(kernel_context_t *prev, kernel_context_t *next);
+extern void ret_from_fork(void);
 
 void scheduler_pick_next(void);
-bool scheduler_thread_create(void(* func)(void *), const void * arg, unsigned int arg_size);
+void scheduler_reschedule(void);
+void scheduler_preempt_point(void);
+void scheduler_record_irq_latency(uint32_t latency_us);
+void scheduler_record_svc_cycles(uint32_t cycles);
+void scheduler_record_tick_entry(uint32_t entry_cycles);
+void scheduler_arm_timer(void);
+bool scheduler_tick_stopped(void);
+bool scheduler_need_resched(void);
+uint32_t scheduler_thread_create(void(* func)(void *), const void * arg, unsigned int arg_size);
+uint32_t scheduler_thread_create_sized(void (*func)(void *), const void *arg, unsigned int arg_size,
+                                       unsigned int stack_size);
 void scheduler_init(void);
 void scheduler_sleep_current(uint32_t ticks);
+void scheduler_exit_current(int32_t status);
+join_result_t scheduler_join(uint32_t handle, int32_t *status);
+bool scheduler_thread_exited(uint32_t handle, bool *exited);
+bool scheduler_block_current(list_node *wait_list, thread_state_t state);
+bool scheduler_block_current_before(list_node *wait_list, tcb_t *waiter, thread_state_t state);
+tcb_t *scheduler_wake_first(list_node *wait_list);
+tcb_t *scheduler_first_waiter(list_node *wait_list);
+tcb_t *scheduler_next_waiter(list_node *wait_list, tcb_t *thread);
+void scheduler_wake_waiter(tcb_t *thread);
+void scheduler_handoff(tcb_t *thread);
+bool scheduler_set_priority(uint32_t priority);
+uint32_t scheduler_get_priority(void);
+uint32_t scheduler_rt_thread_create(void (*func)(void *), const void *arg, unsigned int arg_size,
+                                    uint32_t period_us, uint32_t budget_us, uint32_t deadline_us);
+uint32_t scheduler_rt_wait_next_period(void);
+void scheduler_rt_timer(void);
 void scheduler_tick(void);
+void scheduler_ipi_tick(void);
+uint32_t scheduler_ticks(void);
+const scheduler_stats_t *scheduler_get_stats(void);
 bool scheduler_block_current_on_input(void);
 bool scheduler_has_waiting_input(void);
 tcb_t *scheduler_pop_next_input_waiter(void);
+bool scheduler_block_current_on_read(uint32_t ticks);
+bool scheduler_has_waiting_reader(void);
+tcb_t *scheduler_pop_next_reader(void);
 __attribute__((noreturn)) void scheduler_start(void);
 
 #endif
@@ -0,0 +1,59 @@
+#ifndef SMP_H_
+#define SMP_H_
+
+#include <config.h>
+
+/*
+ * Number of Cortex-A7 cores that run the scheduler. Cores at or above
+ * SMP_CORES stay parked in entry.S. The spinlocks need ldrex/strex, which the
+ * board only supports on cacheable memory, so without an MMU only QEMU gets
+ * all four cores by default. Build with -DSMP_CORES=n to override.
+ */
+#ifndef SMP_CORES
+#ifdef BUILD_FOR_QEMU
+#define SMP_CORES 4
+#else
+#define SMP_CORES 1
+#endif
+#endif
+
+// Größe eines Modus-Stacks pro Kern, siehe stacks.S
+#define MODE_STACK_SIZE 1024
+
+// IPI Nachrichten, als Bits in Mailbox 0 des Zielkerns
+#define SMP_IPI_RESCHEDULE (1u << 0)
+#define SMP_IPI_TICK	   (1u << 1)
+
+#ifndef __ASSEMBLER__
+
+#include <stdint.h>
+
+static_assert(SMP_CORES >= 1 && SMP_CORES <= 4, "raspi2b has four cores");
+
+static inline unsigned int smp_cpu_id(void)
+{
+#if SMP_CORES > 1
+	unsigned int mpidr;
+	__asm__ volatile("mrc p15, 0, %0, c0, c0, 5" : "=r"(mpidr));
+	return mpidr & 3u;
+#else
+	return 0u;
+#endif
+}
+
+void smp_init(void);
+void smp_start_secondaries(void);
+void smp_send_ipi(unsigned int cpu, uint32_t msg);
+uint32_t smp_take_ipi(void);
+/*
+ * Der Kernel Lock wird bei jedem Eintritt in den Kernel genommen (IRQ, SVC,
+ * Abort) und erst beim Verlassen wieder freigegeben. Alle Kernel-Objekte
+ * (Wait Lists, Run Queues, Ports, Rings, ...) verlassen sich darauf und
+ * haben keine eigenen Locks. Er ist nicht rekursiv, Kernel Code darf also
+ * nie selbst einen Syscall auslösen.
+ */
+void smp_kernel_lock(void);
+void smp_kernel_unlock(void);
+
+#endif // __ASSEMBLER__
+#endif // SMP_H_
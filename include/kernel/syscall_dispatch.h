@@ -13,6 +13,20 @@ typedef struct syscall_result {
 	bool advance_pc;
 } syscall_result_t;
 
+/*
+ * Ohne MMU kann ein Userzeiger überall hinzeigen. Erlaubt ist alles ab dem
+ * Kernel Image bis vor die Peripherie, ohne Überlauf.
+ */
+#define USER_MEM_START 0x00008000u
+#define USER_MEM_END   0x3F000000u
+
+static inline bool user_buffer_valid(uint32_t addr, uint32_t len)
+{
+	return addr >= USER_MEM_START && addr < USER_MEM_END && len <= USER_MEM_END - addr;
+}
+
 syscall_result_t syscall_dispatch(context_frame_t *ctx);
+void syscall_output_ready(void);
+bool syscall_output_idle(void);
 
 #endif
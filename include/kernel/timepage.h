@@ -0,0 +1,16 @@
+#ifndef TIMEPAGE_H_
+#define TIMEPAGE_H_
+
+#include <stdint.h>
+
+#include <syscall.h>
+
+/*
+ * Time page shared with user space, see struct time_page. The scheduler
+ * publishes the tick count with time_page_update() whenever it advances.
+ */
+void		  time_page_init(void);
+void		  time_page_update(uint32_t ticks);
+struct time_page *time_page_get(void);
+
+#endif // TIMEPAGE_H_
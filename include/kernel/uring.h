@@ -0,0 +1,34 @@
+#ifndef URING_H_
+#define URING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <syscall.h>
+
+struct tcb;
+
+/*
+ * Submission and completion rings shared with user space, see struct uring.
+ * Requests taken from a ring stay in a per ring table until they complete,
+ * progress comes from syscall_uring_enter, the UART interrupt and the tick.
+ * A ring belongs to the thread that set it up, only that thread may enter or
+ * release it, and it is released when the thread exits.
+ */
+#define URING_MAX 4u
+
+typedef enum {
+	URING_INVALID = 0,
+	URING_DONE,
+	URING_BLOCKED,
+} uring_result_t;
+
+void	       uring_init(void);
+uint32_t       uring_setup(struct uring *ring);
+uring_result_t uring_enter(uint32_t id, uint32_t min_complete, uint32_t *submitted);
+void	       uring_release(uint32_t id);
+void	       uring_thread_exit(const struct tcb *thread);
+void	       uring_poll(void);
+bool	       uring_next_deadline(uint32_t *tick);
+
+#endif // URING_H_
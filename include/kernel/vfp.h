@@ -0,0 +1,28 @@
+#ifndef VFP_H_
+#define VFP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Registerbank von VFP und NEON eines Threads, erst beim ersten FP Trap aus
+ * kmem geholt. cpu ist der Kern, in dessen Registern der aktuelle Stand
+ * liegt, oder VFP_NO_CPU.
+ */
+#define VFP_NO_CPU 0xFFu
+
+typedef struct vfp_state {
+	uint64_t d[32];
+	uint32_t fpscr;
+	uint8_t	 cpu;
+} vfp_state_t;
+
+struct tcb;
+struct context_frame;
+
+void vfp_init(void);
+void vfp_switch(struct tcb *prev, struct tcb *next);
+bool vfp_handle_trap(struct context_frame *ctx);
+void vfp_release(struct tcb *thread);
+
+#endif
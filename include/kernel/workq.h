@@ -0,0 +1,27 @@
+#ifndef WORKQ_H_
+#define WORKQ_H_
+
+#include <stdint.h>
+
+#include <syscall.h>
+
+/*
+ * Kernel work queues for worker pools. Items are queued by value in a ring
+ * of WORKQ_DEPTH entries per queue, idle workers and submitters hitting a
+ * full ring wait in FIFO order.
+ */
+#define WORKQ_MAX   8u
+#define WORKQ_DEPTH 64u
+
+typedef enum {
+	WORKQ_INVALID = 0,
+	WORKQ_DONE,
+	WORKQ_BLOCKED,
+} workq_result_t;
+
+void	       workq_init(void);
+uint32_t       workq_create(void);
+workq_result_t workq_submit(uint32_t id, const struct work_item *item);
+workq_result_t workq_wait(uint32_t id, struct work_item *out);
+
+#endif // WORKQ_H_
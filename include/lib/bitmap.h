@@ -0,0 +1,91 @@
+#ifndef LIB_BITMAP_H_
+#define LIB_BITMAP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * \file bitmap.h
+ * \brief Zweistufige Bitmap mit O(1) Suche nach dem ersten gesetzten Bit
+ *
+ * Bit i liegt MSB-first in Wort i / 32, damit liefert clz auf einem Wort direkt
+ * den kleinsten gesetzten Index. Ein Summary-Wort markiert alle nicht leeren Wörter,
+ * so bleibt die Suche bei zwei clz, egal wie groß die Bitmap ist.
+ */
+
+#define BITMAP_WORDS(bits) (((bits) + 31u) / 32u)
+#define BITMAP_MAX_BITS	   (32u * 32u)
+
+typedef struct bitmap {
+	uint32_t  summary;
+	uint32_t *words;
+} bitmap_t;
+
+// Makro zum anlegen einer (leeren) Bitmap
+#define bitmap_create(name, bits)                                                    \
+	static_assert((bits) >= 1, "Bitmap needs at least one bit");                \
+	static_assert((bits) <= BITMAP_MAX_BITS, "Bitmap exceeds summary word");    \
+	static uint32_t _w_##name[BITMAP_WORDS(bits)];                               \
+	static bitmap_t name = { 0u, _w_##name }
+
+static inline uint32_t bitmap_mask_(unsigned int bit)
+{
+	return 0x80000000u >> (bit & 31u);
+}
+
+[[maybe_unused]] static inline void bitmap_set(bitmap_t *b, unsigned int bit)
+{
+	b->words[bit >> 5] |= bitmap_mask_(bit);
+	b->summary |= bitmap_mask_(bit >> 5);
+}
+
+[[maybe_unused]] static inline void bitmap_clear(bitmap_t *b, unsigned int bit)
+{
+	uint32_t *word = &b->words[bit >> 5];
+	*word &= ~bitmap_mask_(bit);
+	if (*word == 0u) {
+		b->summary &= ~bitmap_mask_(bit >> 5);
+	}
+}
+
+[[nodiscard, maybe_unused]] static inline bool bitmap_test(const bitmap_t *b, unsigned int bit)
+{
+	return (b->words[bit >> 5] & bitmap_mask_(bit)) != 0u;
+}
+
+[[nodiscard, maybe_unused]] static inline bool bitmap_is_empty(const bitmap_t *b)
+{
+	return b->summary == 0u;
+}
+
+// Gibt den kleinsten gesetzten Index zurück, oder -1 wenn die Bitmap leer ist
+[[nodiscard, maybe_unused]] static inline int bitmap_find_first(const bitmap_t *b)
+{
+	if (b->summary == 0u) {
+		return -1;
+	}
+	unsigned int word = (unsigned int)__builtin_clz(b->summary);
+	return (int)(word * 32u + (unsigned int)__builtin_clz(b->words[word]));
+}
+
+/*
+ * Gibt den kleinsten gesetzten Index >= start zurück und fängt sonst wieder bei
+ * 0 an, oder -1 wenn die Bitmap leer ist. start muss kleiner als bits sein.
+ */
+[[nodiscard, maybe_unused]] static inline int bitmap_find_next(const bitmap_t *b, unsigned int start)
+{
+	unsigned int word = start >> 5;
+	uint32_t     bits = b->words[word] & (0xFFFFFFFFu >> (start & 31u));
+	if (bits != 0u) {
+		return (int)(word * 32u + (unsigned int)__builtin_clz(bits));
+	}
+
+	uint32_t later = word < 31u ? b->summary & (0xFFFFFFFFu >> (word + 1u)) : 0u;
+	if (later == 0u) {
+		return bitmap_find_first(b);
+	}
+	word = (unsigned int)__builtin_clz(later);
+	return (int)(word * 32u + (unsigned int)__builtin_clz(b->words[word]));
+}
+
+#endif // LIB_BITMAP_H_
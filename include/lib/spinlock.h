@@ -0,0 +1,44 @@
+#ifndef LIB_SPINLOCK_H_
+#define LIB_SPINLOCK_H_
+
+#include <stdint.h>
+
+/*
+ * \file spinlock.h
+ * \brief Spinlock über ldrex/strex
+ *
+ * Wartende Kerne schlafen mit wfe, spin_unlock weckt sie mit sev. Interrupts
+ * werden nicht angefasst, der Aufrufer muss sie selbst gesperrt haben.
+ */
+
+typedef struct spinlock {
+	volatile uint32_t locked;
+} spinlock_t;
+
+// Makro zum initialisieren eines freien Locks
+#define SPINLOCK_INIT { 0u }
+
+[[maybe_unused]] static inline void spin_lock(spinlock_t *lock)
+{
+	uint32_t busy;
+	__asm__ volatile("1:	ldrex	%0, [%1]\n"
+			 "	teq	%0, #0\n"
+			 "	wfene\n"
+			 "	strexeq	%0, %2, [%1]\n"
+			 "	teqeq	%0, #0\n"
+			 "	bne	1b\n"
+			 "	dmb\n"
+			 : "=&r"(busy)
+			 : "r"(&lock->locked), "r"(1u)
+			 : "cc", "memory");
+}
+
+[[maybe_unused]] static inline void spin_unlock(spinlock_t *lock)
+{
+	__asm__ volatile("dmb" ::: "memory");
+	lock->locked = 0u;
+	__asm__ volatile("dsb\n"
+			 "sev" ::: "memory");
+}
+
+#endif // LIB_SPINLOCK_H_
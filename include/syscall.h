@@ -1,6 +1,7 @@
 #ifndef SYSCALL_H_
 #define SYSCALL_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 enum syscall_id {
@@ -10,6 +11,214 @@ enum syscall_id {
     SYSCALL_ID_CREATE_THREAD = 3u,
     SYSCALL_ID_SLEEP = 4u,
     SYSCALL_ID_UNDEFINED = 5u,
+    SYSCALL_ID_SET_PRIORITY = 6u,
+    SYSCALL_ID_GET_PRIORITY = 7u,
+    SYSCALL_ID_CREATE_RT_THREAD = 8u,
+    SYSCALL_ID_RT_WAIT_NEXT_PERIOD = 9u,
+    SYSCALL_ID_CREATE_THREAD_SIZED = 10u,
+    SYSCALL_ID_JOIN = 11u,
+    SYSCALL_ID_WORKQ_CREATE = 12u,
+    SYSCALL_ID_WORKQ_SUBMIT = 13u,
+    SYSCALL_ID_WORKQ_WAIT = 14u,
+    SYSCALL_ID_WRITE = 15u,
+    SYSCALL_ID_READ = 16u,
+    SYSCALL_ID_RX_RING = 17u,
+    SYSCALL_ID_RX_WAIT = 18u,
+    SYSCALL_ID_URING_SETUP = 19u,
+    SYSCALL_ID_URING_ENTER = 20u,
+    SYSCALL_ID_URING_RELEASE = 21u,
+    SYSCALL_ID_FUTEX_WAIT = 22u,
+    SYSCALL_ID_FUTEX_WAKE = 23u,
+    SYSCALL_ID_FUTEX_CMPXCHG = 24u,
+    SYSCALL_ID_PORT_CREATE = 25u,
+    SYSCALL_ID_PORT_SEND = 26u,
+    SYSCALL_ID_PORT_RECEIVE = 27u,
+    SYSCALL_ID_POLL = 28u,
+    SYSCALL_ID_TIME_PAGE = 29u,
+    SYSCALL_ID_SLEEP_UNTIL = 30u,
+};
+
+/* Thread priorities: higher values are scheduled first, new threads inherit the creator's. */
+#define THREAD_PRIORITY_MIN     0u
+#define THREAD_PRIORITY_MAX     31u
+#define THREAD_PRIORITY_DEFAULT 15u
+
+/*
+ * Periodic real-time thread, scheduled EDF ahead of all other threads.
+ * Each period it may run for budget_us and should finish its job within
+ * deadline_us (0 means deadline_us = period_us). All times in microseconds.
+ */
+struct rt_thread_params {
+    void (*func)(void *);
+    void *args;
+    unsigned int arg_size;
+    unsigned int period_us;
+    unsigned int budget_us;
+    unsigned int deadline_us;
+};
+
+/*
+ * Threads are named by handles: the slot in the kernel's thread table plus a
+ * generation that changes whenever the slot is reused, so a stale handle
+ * never names a newer thread. THREAD_HANDLE_INVALID is returned when a thread
+ * could not be created.
+ */
+typedef uint32_t thread_handle_t;
+#define THREAD_HANDLE_INVALID 0u
+
+/* Exit status of threads the kernel terminated, e.g. after an exception. */
+#define THREAD_EXIT_KILLED (-1)
+
+/*
+ * Thread with its own stack size. The kernel rounds stack_size up to the next
+ * size class between THREAD_STACK_MIN and THREAD_STACK_MAX bytes, the
+ * argument block is copied onto that stack as well. syscall_create_thread
+ * uses 2048 bytes.
+ */
+#define THREAD_STACK_MIN 256u
+#define THREAD_STACK_MAX 16384u
+
+struct thread_params {
+    void (*func)(void *);
+    void *args;
+    unsigned int arg_size;
+    unsigned int stack_size;
+};
+
+/*
+ * Work queues: create a queue and a pool of worker threads once, then submit
+ * work items instead of creating a thread per event. Workers call
+ * syscall_workq_wait in a loop and run item.func(item.arg). Idle workers get
+ * items in FIFO order, bursts are queued in the kernel and a submitter only
+ * blocks while the queue is full.
+ */
+struct work_item {
+    void (*func)(void *);
+    void *arg;
+};
+
+/*
+ * User view of the kernel's UART RX ring, see syscall_rx_ring. The kernel
+ * stores bytes at data[head & mask] and then advances head, the consumer
+ * reads from tail up to head and advances tail to free the bytes. Both
+ * indices run freely. Everything except tail is read-only for user code.
+ * The kernel keeps its own copy of the ring and ignores a tail outside of
+ * the old tail and head.
+ * Use either the ring or syscall_getc/syscall_read, not both.
+ */
+struct rx_ring {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint32_t size;
+    uint32_t mask;
+    const volatile char *data;
+};
+
+/*
+ * Asynchronous syscalls. User code queues requests in the submission ring
+ * (sq) and the kernel posts one completion per request to the completion
+ * ring (cq), in the order they finish. All four indices run freely. User
+ * code writes sq_tail and cq_head, the kernel sq_head and cq_tail.
+ * syscall_uring_enter and the timer tick pick up new requests, up to
+ * URING_ENTRIES are in flight per ring.
+ *
+ * Operations and their arguments:
+ *   URING_OP_PUTC   arg1 = character                      result 0
+ *   URING_OP_WRITE  arg1 = buf, arg2 = len                result len
+ *   URING_OP_READ   arg1 = buf, arg2 = maxlen,
+ *                   arg3 = timeout ticks as syscall_read  result bytes read
+ *   URING_OP_SLEEP  arg1 = ticks                          result 0
+ *   URING_OP_CREATE arg1 = func, arg2 = args,
+ *                   arg3 = arg_size                       result thread handle
+ * Invalid operations or buffers complete with result -1. The timer tick does
+ * not start URING_OP_CREATE itself, the request waits for the next
+ * syscall_uring_enter so the thread inherits the submitter's priority.
+ * URING_OP_PUTC and URING_OP_WRITE wait while threads are blocked in
+ * syscall_putc or syscall_write, so their output is not overtaken.
+ */
+#define URING_ENTRIES 16u
+
+enum uring_op {
+    URING_OP_PUTC = 0u,
+    URING_OP_WRITE = 1u,
+    URING_OP_READ = 2u,
+    URING_OP_SLEEP = 3u,
+    URING_OP_CREATE = 4u,
+};
+
+struct uring_sqe {
+    uint32_t op;
+    uint32_t user_data;
+    uint32_t arg1;
+    uint32_t arg2;
+    uint32_t arg3;
+};
+
+struct uring_cqe {
+    uint32_t user_data;
+    int32_t result;
+};
+
+struct uring {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    struct uring_sqe sq[URING_ENTRIES];
+    struct uring_cqe cq[URING_ENTRIES];
+};
+
+/*
+ * IPC ports: fixed size message queues between threads. A send to a port
+ * with a blocked receiver copies the message directly into the receiver's
+ * buffer and switches to it, otherwise the message is queued. Senders block
+ * while the queue is full, receivers while it is empty.
+ */
+#define IPC_MSG_WORDS 4u
+
+struct ipc_msg {
+    uint32_t words[IPC_MSG_WORDS];
+};
+
+/*
+ * Event descriptors for syscall_poll:
+ *   POLL_UART_READABLE  input is buffered              arg unused
+ *   POLL_TIMEOUT        arg ticks have passed          0 only checks the others
+ *   POLL_THREAD_EXIT    thread arg (a handle) ended
+ *   POLL_PORT_READABLE  IPC port arg holds a message
+ * Nothing is consumed, a ready descriptor only says the matching call
+ * (syscall_read, syscall_join, syscall_port_receive) will not block.
+ */
+#define POLL_MAX_EVENTS 8u
+
+enum poll_event_type {
+    POLL_UART_READABLE = 0u,
+    POLL_TIMEOUT = 1u,
+    POLL_THREAD_EXIT = 2u,
+    POLL_PORT_READABLE = 3u,
+};
+
+struct poll_event {
+    uint32_t type;
+    uint32_t arg;
+    uint32_t ready;
+};
+
+/*
+ * Read-only time page, see syscall_time_page and include/user/time.h. clo and
+ * chi point at the free running 1 MHz systimer. ticks and the systimer value
+ * at that tick (tick_time_hi:lo) are published under the sequence counter
+ * seq: it is odd while the kernel updates them, a reader retries if seq was
+ * odd or changed meanwhile.
+ */
+struct time_page {
+    volatile uint32_t seq;
+    volatile uint32_t ticks;
+    volatile uint32_t tick_time_lo;
+    volatile uint32_t tick_time_hi;
+    uint32_t timer_interval;
+    const volatile uint32_t *clo;
+    const volatile uint32_t *chi;
 };
 
 typedef enum syscall_id syscall_id_t;
@@ -35,22 +244,128 @@ static inline __attribute__((noreturn)) void syscall_exit(void)
     __builtin_unreachable();
 }
 
+/* Like syscall_exit, status is handed to threads joining this one. */
+static inline __attribute__((noreturn)) void syscall_exit_status(int status)
+{
+    (void)syscall_invoke(SYSCALL_ID_EXIT, (uint32_t)status, 0u, 0u);
+    __builtin_unreachable();
+}
+
 static inline void syscall_putc(char c)
 {
     (void)syscall_invoke(SYSCALL_ID_PUTC, (uint32_t)c, 0u, 0u);
 }
 
+/*
+ * Writes len bytes from buf to the console with a single kernel entry. Blocks
+ * while the output buffer is full, writers are served in order so their
+ * output does not interleave. Returns len, or -1 for an invalid buffer.
+ */
+static inline int syscall_write(const char *buf, size_t len)
+{
+    return (int)syscall_invoke(SYSCALL_ID_WRITE, (uint32_t)buf, (uint32_t)len, 0u);
+}
+
+/* Timeout for syscall_read that never runs out. */
+#define READ_TIMEOUT_INFINITE 0xFFFFFFFFu
+
+/*
+ * Reads up to maxlen buffered input bytes into buf. Blocks until at least one
+ * byte is available or timeout_ticks scheduler ticks have passed, 0 does not
+ * block at all. Returns the number of bytes read, 0 on timeout, or -1 for an
+ * invalid buffer.
+ */
+static inline int syscall_read(char *buf, size_t maxlen, uint32_t timeout_ticks)
+{
+    return (int)syscall_invoke(SYSCALL_ID_READ, (uint32_t)buf, (uint32_t)maxlen, timeout_ticks);
+}
+
+/* Returns the shared RX ring, input is then read without a trap per byte. */
+static inline struct rx_ring *syscall_rx_ring(void)
+{
+    return (struct rx_ring *)syscall_invoke(SYSCALL_ID_RX_RING, 0u, 0u, 0u);
+}
+
+/*
+ * Blocks until the RX ring holds input or timeout_ticks have passed, like
+ * syscall_read, but leaves the bytes in the ring. Returns 1 if input is
+ * available, 0 on timeout.
+ */
+static inline int syscall_rx_wait(uint32_t timeout_ticks)
+{
+    return (int)syscall_invoke(SYSCALL_ID_RX_WAIT, 0u, 0u, timeout_ticks);
+}
+
+/*
+ * Points *data at the oldest unread bytes and returns how many follow
+ * contiguously, 0 if the ring is empty. They stay valid until rx_ring_consume.
+ */
+static inline uint32_t rx_ring_peek(const struct rx_ring *ring, const volatile char **data)
+{
+    uint32_t tail = ring->tail;
+    uint32_t avail = ring->head - tail;
+    __asm__ volatile ("dmb" ::: "memory"); /* head before the data it covers */
+
+    uint32_t offset = tail & ring->mask;
+    if (avail > ring->size - offset) {
+        avail = ring->size - offset;
+    }
+    *data = &ring->data[offset];
+    return avail;
+}
+
+/* Hands count peeked bytes back to the kernel. */
+static inline void rx_ring_consume(struct rx_ring *ring, uint32_t count)
+{
+    __asm__ volatile ("dmb" ::: "memory"); /* finish reading before the kernel reuses them */
+    ring->tail += count;
+}
+
 static inline char syscall_getc(void)
 {
     return (char)syscall_invoke(SYSCALL_ID_GETC, 0u, 0u, 0u);
 }
 
-static inline void syscall_create_thread(void (*func)(void *), void *args, unsigned int arg_size)
+static inline thread_handle_t syscall_create_thread(void (*func)(void *), void *args, unsigned int arg_size)
+{
+    return syscall_invoke(SYSCALL_ID_CREATE_THREAD,
+                          (uint32_t)func,
+                          (uint32_t)args,
+                          (uint32_t)arg_size);
+}
+
+static inline thread_handle_t syscall_create_thread_sized(const struct thread_params *params)
+{
+    return syscall_invoke(SYSCALL_ID_CREATE_THREAD_SIZED, (uint32_t)params, 0u, 0u);
+}
+
+/*
+ * Blocks until the thread exits and stores its exit status in *status, which
+ * may be NULL. Returns 0 on success, or 1 for an invalid or stale handle or
+ * the calling thread itself. The status of a thread that exited before the
+ * join stays available until its slot is reused.
+ */
+static inline int syscall_join(thread_handle_t thread, int *status)
+{
+    return (int)syscall_invoke(SYSCALL_ID_JOIN, thread, (uint32_t)status, 0u);
+}
+
+/* Returns the id of a new work queue, or 0 if none is left. */
+static inline unsigned int syscall_workq_create(void)
+{
+    return (unsigned int)syscall_invoke(SYSCALL_ID_WORKQ_CREATE, 0u, 0u, 0u);
+}
+
+/* Returns 0 once the item is queued or taken by a worker, 1 for an invalid queue. */
+static inline int syscall_workq_submit(unsigned int queue, void (*func)(void *), void *arg)
+{
+    return (int)syscall_invoke(SYSCALL_ID_WORKQ_SUBMIT, queue, (uint32_t)func, (uint32_t)arg);
+}
+
+/* Blocks until an item is available and stores it in *item. Returns 0, or 1 for an invalid queue. */
+static inline int syscall_workq_wait(unsigned int queue, struct work_item *item)
 {
-    (void)syscall_invoke(SYSCALL_ID_CREATE_THREAD,
-                         (uint32_t)func,
-                         (uint32_t)args,
-                         (uint32_t)arg_size);
+    return (int)syscall_invoke(SYSCALL_ID_WORKQ_WAIT, queue, (uint32_t)item, 0u);
 }
 
 static inline void syscall_sleep(unsigned int cycles)
@@ -58,6 +373,160 @@ static inline void syscall_sleep(unsigned int cycles)
     (void)syscall_invoke(SYSCALL_ID_SLEEP, cycles, 0u, 0u);
 }
 
+static inline int syscall_set_priority(unsigned int priority)
+{
+    return (int)syscall_invoke(SYSCALL_ID_SET_PRIORITY, priority, 0u, 0u);
+}
+
+static inline unsigned int syscall_get_priority(void)
+{
+    return (unsigned int)syscall_invoke(SYSCALL_ID_GET_PRIORITY, 0u, 0u, 0u);
+}
+
+/*
+ * Returns the handle of the new thread, usable with syscall_join and
+ * POLL_THREAD_EXIT, or THREAD_HANDLE_INVALID if the parameters are invalid or
+ * the thread would exceed the real-time utilization.
+ */
+static inline thread_handle_t syscall_create_rt_thread(const struct rt_thread_params *params)
+{
+    return syscall_invoke(SYSCALL_ID_CREATE_RT_THREAD, (uint32_t)params, 0u, 0u);
+}
+
+/* Ends the current job, returns the number of deadlines missed so far. */
+static inline unsigned int syscall_rt_wait_next_period(void)
+{
+    return (unsigned int)syscall_invoke(SYSCALL_ID_RT_WAIT_NEXT_PERIOD, 0u, 0u, 0u);
+}
+
+/*
+ * Registers ring with the kernel, it has to stay valid until
+ * syscall_uring_release. Returns the ring id, or 0 if none is left.
+ */
+static inline unsigned int syscall_uring_setup(struct uring *ring)
+{
+    ring->sq_head = ring->sq_tail = ring->cq_head = ring->cq_tail = 0u;
+    return (unsigned int)syscall_invoke(SYSCALL_ID_URING_SETUP, (uint32_t)ring, 0u, 0u);
+}
+
+/*
+ * Submits all queued requests and blocks until at least min_complete
+ * completions are waiting, 0 does not block. Returns the number of requests
+ * taken from the submission ring, or -1 for an invalid id.
+ */
+static inline int syscall_uring_enter(unsigned int id, unsigned int min_complete)
+{
+    return (int)syscall_invoke(SYSCALL_ID_URING_ENTER, id, min_complete, 0u);
+}
+
+/* Unregisters the ring, requests still in flight are dropped. */
+static inline void syscall_uring_release(unsigned int id)
+{
+    (void)syscall_invoke(SYSCALL_ID_URING_RELEASE, id, 0u, 0u);
+}
+
+/* Next free submission entry, NULL while the ring is full. Fill it, then call uring_sqe_ready. */
+static inline struct uring_sqe *uring_get_sqe(struct uring *ring)
+{
+    if (ring->sq_tail - ring->sq_head >= URING_ENTRIES) {
+        return 0;
+    }
+    return &ring->sq[ring->sq_tail & (URING_ENTRIES - 1u)];
+}
+
+static inline void uring_sqe_ready(struct uring *ring)
+{
+    __asm__ volatile ("dmb" ::: "memory"); /* entry before the tail that publishes it */
+    ring->sq_tail++;
+}
+
+/* Oldest completion, NULL if none is waiting. Call uring_cqe_seen when done with it. */
+static inline const struct uring_cqe *uring_peek_cqe(const struct uring *ring)
+{
+    if (ring->cq_head == ring->cq_tail) {
+        return 0;
+    }
+    __asm__ volatile ("dmb" ::: "memory");
+    return &ring->cq[ring->cq_head & (URING_ENTRIES - 1u)];
+}
+
+static inline void uring_cqe_seen(struct uring *ring)
+{
+    __asm__ volatile ("dmb" ::: "memory");
+    ring->cq_head++;
+}
+
+/*
+ * Blocks until syscall_futex_wake is called for addr, but only if *addr still
+ * equals expected. Returns 0 after a wakeup, 1 if the value differed, or -1
+ * for an unaligned or invalid address. See include/user/sync.h for locks
+ * built on top.
+ */
+static inline int syscall_futex_wait(volatile uint32_t *addr, uint32_t expected)
+{
+    return (int)syscall_invoke(SYSCALL_ID_FUTEX_WAIT, (uint32_t)addr, expected, 0u);
+}
+
+/* Wakes up to count threads waiting on addr, returns how many were woken. */
+static inline unsigned int syscall_futex_wake(volatile uint32_t *addr, unsigned int count)
+{
+    return (unsigned int)syscall_invoke(SYSCALL_ID_FUTEX_WAKE, (uint32_t)addr, count, 0u);
+}
+
+/*
+ * Atomically replaces *addr with val if it equals old and returns the previous
+ * value. For user atomics where ldrex/strex do not work, see user/sync.c. An
+ * unaligned or invalid address kills the thread like a data abort would.
+ */
+static inline uint32_t syscall_futex_cmpxchg(volatile uint32_t *addr, uint32_t old, uint32_t val)
+{
+    return syscall_invoke(SYSCALL_ID_FUTEX_CMPXCHG, (uint32_t)addr, old, val);
+}
+
+/* Returns the id of a new port, or 0 if none is left. */
+static inline unsigned int syscall_port_create(void)
+{
+    return (unsigned int)syscall_invoke(SYSCALL_ID_PORT_CREATE, 0u, 0u, 0u);
+}
+
+/* Returns 0 once the message is queued or delivered, 1 for an invalid port or message. */
+static inline int syscall_port_send(unsigned int port, const struct ipc_msg *msg)
+{
+    return (int)syscall_invoke(SYSCALL_ID_PORT_SEND, port, (uint32_t)msg, 0u);
+}
+
+/* Blocks until a message arrives and stores it in *msg. Returns 0, or 1 for an invalid port or buffer. */
+static inline int syscall_port_receive(unsigned int port, struct ipc_msg *msg)
+{
+    return (int)syscall_invoke(SYSCALL_ID_PORT_RECEIVE, port, (uint32_t)msg, 0u);
+}
+
+/*
+ * Blocks until at least one of the count events is ready and sets ready to 1
+ * for each ready one, 0 for the rest. Returns the number of ready events, or
+ * -1 for an invalid descriptor or count above POLL_MAX_EVENTS.
+ */
+static inline int syscall_poll(struct poll_event *events, unsigned int count)
+{
+    return (int)syscall_invoke(SYSCALL_ID_POLL, (uint32_t)events, count, 0u);
+}
+
+/* Returns the shared time page, reading it needs no further syscalls. */
+static inline const struct time_page *syscall_time_page(void)
+{
+    return (const struct time_page *)syscall_invoke(SYSCALL_ID_TIME_PAGE, 0u, 0u, 0u);
+}
+
+/*
+ * Sleeps until the systimer reaches abs_time_us, with microsecond resolution
+ * and independent of the scheduling tick. Returns right away for a time that
+ * already passed. See sleep_us and sleep_until in include/user/time.h.
+ */
+static inline void syscall_sleep_until(uint64_t abs_time_us)
+{
+    (void)syscall_invoke(SYSCALL_ID_SLEEP_UNTIL, (uint32_t)abs_time_us, (uint32_t)(abs_time_us >> 32), 0u);
+}
+
 static inline void syscall_undefined(void)
 {
     (void)syscall_invoke(SYSCALL_ID_UNDEFINED, 0u, 0u, 0u);
@@ -0,0 +1,48 @@
+#ifndef USER_SYNC_H_
+#define USER_SYNC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Mutex, condition variable and semaphore for user threads, built on
+ * syscall_futex_wait/syscall_futex_wake. Without contention every operation
+ * stays in user space with ldrex/strex, the kernel is only entered to block
+ * or to wake a waiter. ldrex/strex need cacheable memory, which the board
+ * lacks without an MMU (see include/kernel/smp.h). Hardware builds therefore
+ * do every atomic operation with syscall_futex_cmpxchg instead.
+ */
+
+// state: 0 frei, 1 gesperrt, 2 gesperrt und es wartet jemand
+typedef struct mutex {
+	volatile uint32_t state;
+} mutex_t;
+
+typedef struct condvar {
+	volatile uint32_t seq;
+	volatile uint32_t waiters;
+} condvar_t;
+
+typedef struct semaphore {
+	volatile uint32_t value;
+	volatile uint32_t waiters;
+} semaphore_t;
+
+#define MUTEX_INIT	    { 0u }
+#define CONDVAR_INIT	    { 0u, 0u }
+#define SEMAPHORE_INIT(val) { (val), 0u }
+
+void mutex_lock(mutex_t *m);
+bool mutex_trylock(mutex_t *m);
+void mutex_unlock(mutex_t *m);
+
+// Gibt m frei, wartet auf signal/broadcast und sperrt m wieder
+void condvar_wait(condvar_t *cv, mutex_t *m);
+void condvar_signal(condvar_t *cv);
+void condvar_broadcast(condvar_t *cv);
+
+void sem_wait(semaphore_t *s);
+bool sem_trywait(semaphore_t *s);
+void sem_post(semaphore_t *s);
+
+#endif // USER_SYNC_H_
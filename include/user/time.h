@@ -0,0 +1,28 @@
+#ifndef USER_TIME_H_
+#define USER_TIME_H_
+
+#include <stdint.h>
+
+/*
+ * Timestamps without a syscall, read from the shared time page (see struct
+ * time_page in syscall.h). Only the first call traps once to look the page up.
+ */
+
+// Mikrosekunden seit dem Start, aus dem 64 Bit Systimer
+uint64_t time_now_us(void);
+
+// Scheduler Ticks und der Zeitpunkt in us, zu dem der letzte gezählt wurde
+uint32_t time_ticks(uint64_t *tick_time_us);
+
+// Länge eines Ticks in us, TIMER_INTERVAL aus config.h
+uint32_t time_tick_interval_us(void);
+
+/*
+ * Schläft n Mikrosekunden bzw. bis time_now_us() abs_time_us erreicht, ohne auf
+ * den nächsten Tick zu runden. Periodische Schleifen rechnen mit einer absoluten
+ * Zeit weiter (next += period; sleep_until(next)), dann driftet nichts.
+ */
+void sleep_us(uint32_t n);
+void sleep_until(uint64_t abs_time_us);
+
+#endif // USER_TIME_H_
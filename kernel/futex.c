@@ -0,0 +1,88 @@
+#include <kernel/futex.h>
+#include <kernel/scheduler.h>
+#include <kernel/syscall_dispatch.h>
+
+#include <lib/list.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A waiter keeps its futex address in r1 of its context, that is how
+ * futex_wake tells the waiters of a shared bucket apart. The value check in
+ * futex_wait and the wakeup both run under the kernel lock, so a wake that
+ * follows a change of the value cannot slip in between check and block.
+ */
+static list_node g_futex_queues[1u << FUTEX_HASH_BITS];
+
+static list_node *futex_queue(uint32_t addr)
+{
+	return &g_futex_queues[((addr >> 2) * 0x9E3779B1u) >> (32u - FUTEX_HASH_BITS)];
+}
+
+static bool futex_addr_valid(uint32_t addr)
+{
+	return (addr & 3u) == 0u && user_buffer_valid(addr, sizeof(uint32_t));
+}
+
+void futex_init(void)
+{
+	for (unsigned int i = 0; i < (1u << FUTEX_HASH_BITS); ++i) {
+		g_futex_queues[i] = (list_node){ &g_futex_queues[i], &g_futex_queues[i] };
+	}
+}
+
+futex_result_t futex_wait(uint32_t addr, uint32_t expected)
+{
+	if (!futex_addr_valid(addr)) {
+		return FUTEX_INVALID;
+	}
+	if (*(volatile uint32_t *)addr != expected) {
+		return FUTEX_AGAIN;
+	}
+
+	if (!scheduler_block_current(futex_queue(addr), T_BLOCKED)) {
+		return FUTEX_INVALID;
+	}
+	return FUTEX_BLOCKED;
+}
+
+/*
+ * Compare-and-swap for user space on the board, where ldrex/strex need
+ * cacheable memory. Atomic because every user of it holds the kernel lock.
+ */
+bool futex_cmpxchg(uint32_t addr, uint32_t old, uint32_t val, uint32_t *prev)
+{
+	if (!futex_addr_valid(addr)) {
+		return false;
+	}
+
+	volatile uint32_t *word = (volatile uint32_t *)addr;
+	*prev			= *word;
+	if (*prev == old) {
+		*word = val;
+	}
+	return true;
+}
+
+/* Wakes up to count waiters of addr in FIFO order, returns how many. */
+uint32_t futex_wake(uint32_t addr, uint32_t count)
+{
+	if (!futex_addr_valid(addr)) {
+		return 0u;
+	}
+
+	list_node *queue = futex_queue(addr);
+	uint32_t   woken = 0u;
+	tcb_t	  *waiter = scheduler_first_waiter(queue);
+	while (waiter && woken < count) {
+		tcb_t *next = scheduler_next_waiter(queue, waiter);
+		if (waiter->ctx_storage.r1 == addr) {
+			scheduler_wake_waiter(waiter);
+			woken++;
+		}
+		waiter = next;
+	}
+	return woken;
+}
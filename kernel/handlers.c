@@ -1,6 +1,12 @@
 #include <kernel/handlers.h>
+#include <kernel/hrtimer.h>
+#include <kernel/pmu.h>
+#include <kernel/poll.h>
 #include <kernel/scheduler.h>
+#include <kernel/smp.h>
+#include <kernel/vfp.h>
 #include <kernel/syscall_dispatch.h>
+#include <kernel/uring.h>
 
 #include <lib/kprintf.h>
 
@@ -11,7 +17,6 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
-#include <string.h>
 #include <config.h>
 
 #include <syscall.h>
@@ -29,43 +34,41 @@ static uint32_t read_ifsr(void);
 static uint32_t read_ifar(void);
 static bool is_user_thread(const context_frame_t *ctx);
 
-static context_frame_t *current_ctx_storage(void)
-{
-	return g_current ? &g_current->ctx_storage : NULL;
-}
+/*
+ * Handlers run on the kernel stack of the interrupted thread and ctx is the
+ * frame on top of it. For exceptions from user mode that is
+ * g_current->ctx_storage, so the handlers never copy register state. A
+ * reschedule switches kernel stacks and returns only when the thread runs
+ * again, the assembly entry then returns through the same frame.
+ */
 
-static void save_current_context(context_frame_t *ctx)
+void irq_handler(context_frame_t *ctx, uint32_t entry_cycles)
 {
-	context_frame_t *dst = current_ctx_storage();
-	if (dst && ctx) {
-		memcpy(dst, ctx, sizeof(context_frame_t));
+	smp_kernel_lock();
+
+	bool reschedule = false;
+	uint32_t ipi = smp_take_ipi();
+	if (ipi & SMP_IPI_TICK) {
+		scheduler_ipi_tick();
+		scheduler_record_tick_entry(entry_cycles);
+		reschedule = true;
 	}
-}
-
-static void restore_current_context(context_frame_t *ctx)
-{
-	context_frame_t *src = current_ctx_storage();
-	if (src && ctx) {
-		memcpy(ctx, src, sizeof(context_frame_t));
+	if (ipi & SMP_IPI_RESCHEDULE) {
+		reschedule = true;
 	}
-}
 
-static context_frame_t *report_context(context_frame_t *fallback)
-{
-	context_frame_t *ctx = current_ctx_storage();
-	return ctx ? ctx : fallback;
-}
-
-void irq_handler(context_frame_t *ctx)
-{
-	save_current_context(ctx);
-
-	if (irq_get_uart_pending()) {
+	// Peripherie-Interrupts werden nur an Core 0 geroutet
+	if (smp_cpu_id() == 0u && irq_get_uart_pending()) {
 		if (uart_get_rx_interrupt_status()) {
 			while (uart_rx_data_available_and_buffer_not_full()) {
 				char c = uart_rx_get_char();
+				// Kein syscall_exit hier, der svc würde den Kernel Lock ein zweites Mal nehmen.
+				// Mitten in einem Syscall (SVC Mode) wird nicht abgebrochen.
 				if (c == 'S') {
-					syscall_exit();
+					if (is_user_thread(ctx)) {
+						scheduler_exit_current(THREAD_EXIT_KILLED);
+						reschedule = true;
+					}
 					continue;
 				}
 				if (!uart_buffer_putc(c)) {
@@ -74,6 +77,11 @@ void irq_handler(context_frame_t *ctx)
 			}
 		}
 
+		if (uart_get_tx_interrupt_status()) {
+			uart_tx_from_buffer();
+			syscall_output_ready();
+		}
+
 		while (scheduler_has_waiting_input()) {
 			char available;
 			if (!uart_peekc(&available)) {
@@ -92,155 +100,172 @@ void irq_handler(context_frame_t *ctx)
 
 			waiter->ctx_storage.r0 = (uint32_t)(uint8_t)delivered;
 		}
+
+		// Jeder Leser bekommt alles Gepufferte in einem Rutsch, syscall_rx_wait
+		// Leser ohne Buffer werden nur geweckt und lassen die Eingabe liegen
+		while (scheduler_has_waiting_reader()) {
+			char available;
+			if (!uart_peekc(&available)) {
+				break;
+			}
+
+			tcb_t *reader = scheduler_pop_next_reader();
+			if (reader->ctx_storage.r2 == 0u) {
+				reader->ctx_storage.r0 = 1u;
+				continue;
+			}
+			reader->ctx_storage.r0 = uart_read_nonblocking((char *)reader->ctx_storage.r1,
+								       reader->ctx_storage.r2);
+		}
+
+		poll_notify(POLL_UART_READABLE, 0u);
+		uring_poll();
 	}
 
-	if (irq_get_systimer_pending(1)) {
+	if (smp_cpu_id() == 0u && irq_get_systimer_pending(1)) {
+		scheduler_record_irq_latency(systimer_now() - systimer_get_compare(1));
 		systimer_clear_match(1);
-		systimer_increment_compare(1, TIMER_INTERVAL);
 		scheduler_tick();
-		scheduler_pick_next();
+		poll_tick();
+		uring_poll();
+		scheduler_record_tick_entry(entry_cycles);
+		reschedule = true;
+	}
+
+	if (smp_cpu_id() == 0u && irq_get_systimer_pending(HRTIMER_CHANNEL)) {
+		hrtimer_expire();
+		reschedule = true;
+	}
+
+	if (smp_cpu_id() == 0u && irq_get_systimer_pending(3)) {
+		systimer_clear_match(3);
+		scheduler_rt_timer();
+		reschedule = true;
+	}
+
+	// Auch ohne Tick umschalten, wenn ein geweckter Thread vorgeht
+	if (reschedule || scheduler_need_resched()) {
+		scheduler_reschedule();
 	}
 
-	restore_current_context(ctx);
+	smp_kernel_unlock();
 }
 
-void svc_handler(context_frame_t *ctx)
+void svc_handler(context_frame_t *ctx, uint32_t entry_cycles)
 {
-	__asm__ volatile("cpsid i" ::: "memory");
-	save_current_context(ctx);
+	smp_kernel_lock();
 
-	context_frame_t *fault_ctx = report_context(ctx);
-	if (!is_user_thread(fault_ctx)) {
+	if (!is_user_thread(ctx)) {
 		struct exception_info info = {
 			.exception_name		 = "Kernel Supervisor Call",
-			.exception_source_addr = fault_ctx ? fault_ctx->lr_exc : 0U,
+			.exception_source_addr = ctx->lr_exc,
 		};
 
-		print_exception_infos(fault_ctx, &info);
+		print_exception_infos(ctx, &info);
 		panic();
 	}
 
 	syscall_result_t result = syscall_dispatch(ctx);
-	context_frame_t *stored_ctx = current_ctx_storage();
-	if (stored_ctx) {
-		if (result.handled) {
-			stored_ctx->r0 = result.value;
-		}
-		if (result.advance_pc) {
-			stored_ctx->lr_exc += 4u;
-		}
+	if (result.handled) {
+		ctx->r0 = result.value;
+	}
+	if (result.advance_pc) {
+		ctx->lr_exc += 4u;
 	}
 
 	if (!result.handled) {
 		struct exception_info info = {
 			.exception_name		 = "Unknown Syscall",
-			.exception_source_addr = fault_ctx ? fault_ctx->lr_exc - 4u : 0u,
+			.exception_source_addr = ctx->lr_exc - 4u,
 		};
 
-		print_exception_infos(fault_ctx, &info);
-		if (g_current) {
-			g_current->state = T_UNUSED;
-		}
+		print_exception_infos(ctx, &info);
+		scheduler_exit_current(THREAD_EXIT_KILLED);
 		result.reschedule = true;
 	}
 
-	if (result.reschedule) {
-		systimer_increment_compare(1, TIMER_INTERVAL);
-		scheduler_pick_next();
+	// Gemessen wird nur der Weg ohne Umschalten, sonst zählten fremde Threads mit
+	if (result.reschedule || scheduler_need_resched()) {
+		scheduler_reschedule();
+	} else {
+		scheduler_record_svc_cycles(pmu_cycles() - entry_cycles);
 	}
 
-	restore_current_context(ctx);
-	__asm__ volatile("cpsie i" ::: "memory");
+	smp_kernel_unlock();
 }
 
 void undefined_handler(context_frame_t *ctx)
 {
-	__asm__ volatile("cpsid i" ::: "memory");
-	save_current_context(ctx);
+	smp_kernel_lock();
+
+	if (is_user_thread(ctx) && vfp_handle_trap(ctx)) {
+		smp_kernel_unlock();
+		return;
+	}
 
-	context_frame_t *fault_ctx = report_context(ctx);
 	struct exception_info info = {
 		.exception_name		 = "Undefined Instruction",
-		.exception_source_addr = fault_ctx ? fault_ctx->lr_exc : 0U,
+		.exception_source_addr = ctx->lr_exc,
 	};
 
-	print_exception_infos(fault_ctx, &info);
+	print_exception_infos(ctx, &info);
 
-	if (!is_user_thread(fault_ctx)) {
+	if (!is_user_thread(ctx)) {
 		panic();
 	}
 
-	if (g_current) {
-		g_current->state = T_UNUSED;
-	}
-	
-	systimer_increment_compare(1, TIMER_INTERVAL);
-	scheduler_pick_next();
+	scheduler_exit_current(THREAD_EXIT_KILLED);
+	scheduler_reschedule();
 
-	restore_current_context(ctx);
-	__asm__ volatile("cpsie i" ::: "memory");
+	smp_kernel_unlock();
 }
 
 void prefetch_abort_handler(context_frame_t *ctx)
 {
-	__asm__ volatile("cpsid i" ::: "memory");
-	save_current_context(ctx);
+	smp_kernel_lock();
 
-	context_frame_t *fault_ctx = report_context(ctx);
 	struct exception_info info = {
 		.exception_name		 = "Prefetch Abort",
-		.exception_source_addr = fault_ctx ? fault_ctx->lr_exc : 0U,
+		.exception_source_addr = ctx->lr_exc,
 		.is_prefetch_abort			= true,
 		.instruction_fault_status_register	= read_ifsr(),
 		.instruction_fault_address_register = read_ifar(),
 	};
 
-	print_exception_infos(fault_ctx, &info);
+	print_exception_infos(ctx, &info);
 
-	if (!is_user_thread(fault_ctx)) {
+	if (!is_user_thread(ctx)) {
 		panic();
 	}
 
-	if (g_current) {
-		g_current->state = T_UNUSED;
-	}
-	
-	systimer_increment_compare(1, TIMER_INTERVAL);
-	scheduler_pick_next();
+	scheduler_exit_current(THREAD_EXIT_KILLED);
+	scheduler_reschedule();
 
-	restore_current_context(ctx);
-	__asm__ volatile("cpsie i" ::: "memory");
+	smp_kernel_unlock();
 }
 
 void data_abort_handler(context_frame_t *ctx)
 {
-	__asm__ volatile("cpsid i" ::: "memory");
-	save_current_context(ctx);
+	smp_kernel_lock();
 
-	context_frame_t *fault_ctx = report_context(ctx);
 	struct exception_info info = {
 		.exception_name		 = "Data Abort",
-		.exception_source_addr = fault_ctx ? fault_ctx->lr_exc : 0U,
+		.exception_source_addr = ctx->lr_exc,
 		.is_data_abort		 = true,
 		.data_fault_status_register = read_dfsr(),
 		.data_fault_address_register = read_dfar(),
 	};
 
-	print_exception_infos(fault_ctx, &info);
+	print_exception_infos(ctx, &info);
 
-	if (!is_user_thread(fault_ctx)) {
+	if (!is_user_thread(ctx)) {
 		panic();
 	}
 
-	if (g_current) {
-		g_current->state = T_UNUSED;
-	}
-	
-	systimer_increment_compare(1, TIMER_INTERVAL);
-	scheduler_pick_next();
+	scheduler_exit_current(THREAD_EXIT_KILLED);
+	scheduler_reschedule();
 
-	restore_current_context(ctx);
-	__asm__ volatile("cpsie i" ::: "memory");
+	smp_kernel_unlock();
 }
 
 __attribute__((noreturn)) static void panic(void)	
@@ -0,0 +1,85 @@
+#include <kernel/hrtimer.h>
+#include <kernel/scheduler.h>
+
+#include <arch/bsp/irq.h>
+#include <arch/bsp/systimer.h>
+
+#include <lib/list.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Sleepers wait on g_hrtimer_sleepers sorted by their absolute deadline,
+ * which stays in r1 (low word) and r2 (high word) of their context. Equal
+ * deadlines keep FIFO order. The channel is always armed for the head.
+ */
+static list_node g_hrtimer_sleepers = { &g_hrtimer_sleepers, &g_hrtimer_sleepers };
+
+// Ein Compare Wert so knapp vor clo würde erst nach einem Überlauf treffen
+#define HRTIMER_MIN_EVENT_US 10u
+// c2 vergleicht nur clo, weiter entfernte Deadlines brauchen Zwischenstopps
+#define HRTIMER_MAX_EVENT_US 0x7FFFFFFFu
+
+static uint64_t sleeper_deadline(const tcb_t *thread)
+{
+	return ((uint64_t)thread->ctx_storage.r2 << 32) | thread->ctx_storage.r1;
+}
+
+static void hrtimer_arm(uint64_t now)
+{
+	tcb_t *sleeper = scheduler_first_waiter(&g_hrtimer_sleepers);
+	if (!sleeper) {
+		irq_disable_systimer(HRTIMER_CHANNEL);
+		return;
+	}
+
+	uint64_t earliest = sleeper_deadline(sleeper);
+	uint64_t delta	  = earliest > now ? earliest - now : 0u;
+	if (delta < HRTIMER_MIN_EVENT_US) {
+		delta = HRTIMER_MIN_EVENT_US;
+	} else if (delta > HRTIMER_MAX_EVENT_US) {
+		delta = HRTIMER_MAX_EVENT_US;
+	}
+	systimer_set_compare(HRTIMER_CHANNEL, (uint32_t)(now + delta));
+	systimer_clear_match(HRTIMER_CHANNEL);
+	irq_enable_systimer(HRTIMER_CHANNEL);
+}
+
+void hrtimer_init(void)
+{
+	irq_disable_systimer(HRTIMER_CHANNEL);
+	systimer_clear_match(HRTIMER_CHANNEL);
+}
+
+hrtimer_result_t hrtimer_sleep_until(uint64_t deadline_us)
+{
+	uint64_t now = systimer_now64();
+	if (deadline_us <= now) {
+		return HRTIMER_DONE;
+	}
+
+	// Vor dem ersten Sleeper mit späterer Deadline einreihen
+	tcb_t *later = scheduler_first_waiter(&g_hrtimer_sleepers);
+	while (later && sleeper_deadline(later) <= deadline_us) {
+		later = scheduler_next_waiter(&g_hrtimer_sleepers, later);
+	}
+	if (!scheduler_block_current_before(&g_hrtimer_sleepers, later, T_SLEEPING)) {
+		return HRTIMER_INVALID;
+	}
+	hrtimer_arm(now);
+	return HRTIMER_BLOCKED;
+}
+
+/* Systimer channel HRTIMER_CHANNEL fired: wakes every sleeper whose deadline passed. */
+void hrtimer_expire(void)
+{
+	systimer_clear_match(HRTIMER_CHANNEL);
+
+	uint64_t now = systimer_now64();
+	tcb_t	*sleeper;
+	while ((sleeper = scheduler_first_waiter(&g_hrtimer_sleepers)) != NULL && sleeper_deadline(sleeper) <= now) {
+		(void)scheduler_wake_first(&g_hrtimer_sleepers);
+	}
+	hrtimer_arm(now);
+}
@@ -0,0 +1,101 @@
+#include <kernel/ipc.h>
+#include <kernel/msgq.h>
+#include <kernel/poll.h>
+#include <kernel/scheduler.h>
+#include <kernel/syscall_dispatch.h>
+
+#include <lib/list.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A send to a port with a waiting receiver copies the message straight into
+ * the receiver's buffer (its r2) and hands the core over to it with
+ * scheduler_handoff(), the queue is skipped. Otherwise the message goes into
+ * the ring, and when that is full the sender blocks with its message pointer
+ * in r2 until a receiver frees an entry.
+ */
+static msgq_t	      g_ports[IPC_PORT_MAX];
+static struct ipc_msg g_port_msgs[IPC_PORT_MAX][IPC_PORT_DEPTH];
+
+static bool ipc_msg_valid(const struct ipc_msg *msg)
+{
+	return ((uint32_t)msg & 3u) == 0u && user_buffer_valid((uint32_t)msg, sizeof(*msg));
+}
+
+void ipc_init(void)
+{
+	for (unsigned int i = 0; i < IPC_PORT_MAX; ++i) {
+		msgq_init(&g_ports[i], g_port_msgs[i], sizeof(struct ipc_msg), IPC_PORT_DEPTH);
+	}
+}
+
+/* Returns the id of a new port, or 0 if all IPC_PORT_MAX are in use. */
+uint32_t ipc_port_create(void)
+{
+	return msgq_create(g_ports, IPC_PORT_MAX);
+}
+
+ipc_result_t ipc_send(uint32_t id, const struct ipc_msg *msg)
+{
+	msgq_t *port = msgq_get(g_ports, IPC_PORT_MAX, id);
+	if (!port || !ipc_msg_valid(msg)) {
+		return IPC_INVALID;
+	}
+
+	tcb_t *receiver = scheduler_first_waiter(&port->receivers);
+	if (receiver) {
+		*(struct ipc_msg *)receiver->ctx_storage.r2 = *msg;
+		receiver->ctx_storage.r0		    = 0u;
+		scheduler_handoff(receiver);
+		return IPC_DONE;
+	}
+
+	if (!msgq_full(port)) {
+		msgq_push(port, msg);
+		poll_notify(POLL_PORT_READABLE, id);
+		return IPC_DONE;
+	}
+
+	if (!scheduler_block_current(&port->senders, T_BLOCKED)) {
+		return IPC_INVALID;
+	}
+	return IPC_BLOCKED;
+}
+
+ipc_result_t ipc_receive(uint32_t id, struct ipc_msg *out)
+{
+	msgq_t *port = msgq_get(g_ports, IPC_PORT_MAX, id);
+	if (!port || !ipc_msg_valid(out)) {
+		return IPC_INVALID;
+	}
+
+	if (port->count == 0u) {
+		if (!scheduler_block_current(&port->receivers, T_BLOCKED)) {
+			return IPC_INVALID;
+		}
+		return IPC_BLOCKED;
+	}
+
+	msgq_pop(port, out);
+
+	tcb_t *sender = scheduler_wake_first(&port->senders);
+	if (sender) {
+		msgq_push(port, (const struct ipc_msg *)sender->ctx_storage.r2);
+		sender->ctx_storage.r0 = 0u;
+	}
+	return IPC_DONE;
+}
+
+/* Returns false for an invalid port, otherwise *readable says whether a receive would not block. */
+bool ipc_port_readable(uint32_t id, bool *readable)
+{
+	msgq_t *port = msgq_get(g_ports, IPC_PORT_MAX, id);
+	if (!port) {
+		return false;
+	}
+	*readable = port->count != 0u;
+	return true;
+}
@@ -0,0 +1,159 @@
+#include <kernel/kmem.h>
+#include <kernel/scheduler.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Segregated free lists over one pool. Requests are rounded up to a size
+ * class and blocks are never split or merged, so kmem_alloc() and
+ * kmem_free() are O(1). Fresh blocks are carved from the pool with a bump
+ * pointer.
+ *
+ * Blocks are handed out zeroed. kmem_free() puts a block on the dirty list of
+ * its class, the idle threads zero it with kmem_scrub() and move it to the
+ * clean list. The pool above g_kmem.zeroed still holds whatever was in RAM at
+ * boot and is cleared the same way. Only when the idle threads are behind
+ * does kmem_alloc() zero memory itself.
+ *
+ * All functions expect the kernel lock.
+ */
+#define KMEM_CLASSES	 9u
+#define KMEM_SCRUB_CHUNK 256u
+
+static_assert(KMEM_POOL_SIZE % KMEM_SCRUB_CHUNK == 0u, "pool is scrubbed in whole chunks");
+
+static const uint32_t g_class_size[KMEM_CLASSES] = {
+	KMEM_MIN_BLOCK, 512u, 1024u, 1280u, 1536u, 2048u, 4096u, 8192u, KMEM_MAX_BLOCK,
+};
+
+typedef struct kmem_block {
+	struct kmem_block *next;
+} kmem_block_t;
+
+static struct {
+	uint8_t	     *bump;
+	uint8_t	     *zeroed;
+	kmem_block_t *clean[KMEM_CLASSES];
+	kmem_block_t *dirty[KMEM_CLASSES];
+} g_kmem;
+
+extern uint8_t _kmem_pool_base[];
+extern uint8_t _kmem_pool_end[];
+
+static int kmem_class(size_t size)
+{
+	for (unsigned int cls = 0; cls < KMEM_CLASSES; ++cls) {
+		if (size <= g_class_size[cls]) {
+			return (int)cls;
+		}
+	}
+	return -1;
+}
+
+static kmem_block_t *kmem_pop(kmem_block_t **list)
+{
+	kmem_block_t *block = *list;
+	if (block) {
+		*list = block->next;
+		block->next = NULL;
+	}
+	return block;
+}
+
+static void kmem_push(kmem_block_t **list, void *ptr)
+{
+	kmem_block_t *block = ptr;
+	block->next = *list;
+	*list = block;
+}
+
+void kmem_init(void)
+{
+	g_kmem.bump   = _kmem_pool_base;
+	g_kmem.zeroed = _kmem_pool_base;
+	for (unsigned int cls = 0; cls < KMEM_CLASSES; ++cls) {
+		g_kmem.clean[cls] = NULL;
+		g_kmem.dirty[cls] = NULL;
+	}
+}
+
+/* Size of the block kmem_alloc(size) returns, or 0 if size is too large. */
+size_t kmem_block_size(size_t size)
+{
+	int cls = kmem_class(size);
+	return cls < 0 ? 0u : g_class_size[cls];
+}
+
+void *kmem_alloc(size_t size)
+{
+	int cls = kmem_class(size);
+	if (cls < 0) {
+		return NULL;
+	}
+
+	kmem_block_t *block = kmem_pop(&g_kmem.clean[cls]);
+	if (block) {
+		return block;
+	}
+
+	block = kmem_pop(&g_kmem.dirty[cls]);
+	if (block) {
+		memset(block, 0, g_class_size[cls]);
+		return block;
+	}
+
+	if ((size_t)(_kmem_pool_end - g_kmem.bump) < g_class_size[cls]) {
+		return NULL;
+	}
+
+	block = (kmem_block_t *)g_kmem.bump;
+	g_kmem.bump += g_class_size[cls];
+	if (g_kmem.zeroed < g_kmem.bump) {
+		memset(g_kmem.zeroed, 0, (size_t)(g_kmem.bump - g_kmem.zeroed));
+		g_kmem.zeroed = g_kmem.bump;
+	}
+	return block;
+}
+
+/* size must be the size passed to kmem_alloc(), or any size of the same class. */
+void kmem_free(void *ptr, size_t size)
+{
+	int cls = kmem_class(size);
+	if (!ptr || cls < 0) {
+		return;
+	}
+	kmem_push(&g_kmem.dirty[cls], ptr);
+}
+
+/*
+ * One step of idle work. Zeroes a dirty block, with preemption points between
+ * the chunks since the block belongs to nobody meanwhile, or one chunk of the
+ * untouched pool. Returns false once there is nothing left to do.
+ */
+bool kmem_scrub(void)
+{
+	for (unsigned int cls = 0; cls < KMEM_CLASSES; ++cls) {
+		kmem_block_t *block = kmem_pop(&g_kmem.dirty[cls]);
+		if (!block) {
+			continue;
+		}
+
+		uint8_t *bytes = (uint8_t *)block;
+		for (uint32_t offset = 0; offset < g_class_size[cls]; offset += KMEM_SCRUB_CHUNK) {
+			memset(bytes + offset, 0, KMEM_SCRUB_CHUNK);
+			scheduler_preempt_point();
+		}
+		kmem_push(&g_kmem.clean[cls], block);
+		return true;
+	}
+
+	if (g_kmem.zeroed < _kmem_pool_end) {
+		memset(g_kmem.zeroed, 0, KMEM_SCRUB_CHUNK);
+		g_kmem.zeroed += KMEM_SCRUB_CHUNK;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,61 @@
+#include <kernel/msgq.h>
+
+#include <lib/list.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+void msgq_init(msgq_t *q, void *entries, size_t entry_size, uint32_t depth)
+{
+	q->used	      = false;
+	q->head	      = 0u;
+	q->count      = 0u;
+	q->depth      = depth;
+	q->entry_size = entry_size;
+	q->entries    = entries;
+	q->receivers  = (list_node){ &q->receivers, &q->receivers };
+	q->senders    = (list_node){ &q->senders, &q->senders };
+}
+
+/* Returns the id of a new queue, or 0 if all n are in use. */
+uint32_t msgq_create(msgq_t *queues, unsigned int n)
+{
+	for (unsigned int i = 0; i < n; ++i) {
+		msgq_t *q = &queues[i];
+		if (!q->used) {
+			q->used	 = true;
+			q->head	 = 0u;
+			q->count = 0u;
+			return i + 1u;
+		}
+	}
+	return 0u;
+}
+
+msgq_t *msgq_get(msgq_t *queues, unsigned int n, uint32_t id)
+{
+	if (id == 0u || id > n || !queues[id - 1u].used) {
+		return NULL;
+	}
+	return &queues[id - 1u];
+}
+
+bool msgq_full(const msgq_t *q)
+{
+	return q->count == q->depth;
+}
+
+void msgq_push(msgq_t *q, const void *entry)
+{
+	memcpy(q->entries + ((q->head + q->count) % q->depth) * q->entry_size, entry, q->entry_size);
+	q->count++;
+}
+
+void msgq_pop(msgq_t *q, void *out)
+{
+	memcpy(out, q->entries + q->head * q->entry_size, q->entry_size);
+	q->head = (q->head + 1u) % q->depth;
+	q->count--;
+}
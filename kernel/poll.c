@@ -0,0 +1,271 @@
+#include <kernel/poll.h>
+#include <kernel/ipc.h>
+#include <kernel/kmem.h>
+#include <kernel/scheduler.h>
+#include <kernel/syscall_dispatch.h>
+
+#include <arch/bsp/uart.h>
+
+#include <lib/list.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * A blocked poller owns a poll table from kmem. It waits on the table's own
+ * wait list and has one entry per watched queue in entries[], at most one per
+ * queue. The descriptors are copied into the table, so only the ready flags
+ * are ever written back to the user array. poll_notify() re-checks that copy
+ * for every table on the queue and fires the ready ones: all entries leave
+ * their queues, the results go to the user array and r0, the poller is woken
+ * and the table freed. So nothing is left behind once the poller runs again.
+ * Timeouts are kept as a deadline on g_poll_timers, sorted like the
+ * scheduler's sleep queue, see poll_tick().
+ */
+typedef struct poll_entry {
+	list_node	   link;
+	struct poll_table *table;
+} poll_entry_t;
+
+typedef struct poll_table {
+	list_node	   wait;
+	list_node	   timer_link;
+	struct poll_event *user;
+	struct poll_event  events[POLL_MAX_EVENTS];
+	uint32_t	   count;
+	uint32_t	   start;
+	uint32_t	   deadline;
+	bool		   timed;
+	poll_entry_t	   entries[POLL_MAX_EVENTS];
+} poll_table_t;
+
+// Queue 0 für UART Eingabe, 1 für Thread-Enden, danach eine pro IPC Port
+#define POLL_QUEUE_UART	 0u
+#define POLL_QUEUE_EXIT	 1u
+#define POLL_QUEUE_PORTS 2u
+
+static list_node g_poll_queues[POLL_QUEUE_PORTS + IPC_PORT_MAX];
+static list_node g_poll_timers = { &g_poll_timers, &g_poll_timers };
+
+static bool deadline_passed(uint32_t deadline)
+{
+	return (int32_t)(scheduler_ticks() - deadline) >= 0;
+}
+
+static poll_table_t *table_from_timer_link(list_node *node)
+{
+	return (poll_table_t *)((char *)node - offsetof(poll_table_t, timer_link));
+}
+
+// Sortiert nach deadline, gleiche Deadlines bleiben FIFO
+static void poll_timer_insert(poll_table_t *table)
+{
+	list_node *pos = g_poll_timers.prev;
+	while (pos != &g_poll_timers && (int32_t)(table_from_timer_link(pos)->deadline - table->deadline) > 0) {
+		pos = pos->prev;
+	}
+	list_add_(&table->timer_link, pos);
+}
+
+static list_node *poll_queue(uint32_t type, uint32_t arg)
+{
+	switch (type) {
+	case POLL_UART_READABLE:
+		return &g_poll_queues[POLL_QUEUE_UART];
+	case POLL_THREAD_EXIT:
+		return &g_poll_queues[POLL_QUEUE_EXIT];
+	case POLL_PORT_READABLE:
+		return arg != 0u && arg <= IPC_PORT_MAX ? &g_poll_queues[POLL_QUEUE_PORTS + arg - 1u] : NULL;
+	default:
+		return NULL;
+	}
+}
+
+/* Whether the descriptor is valid, *ready is set for a valid one. */
+static bool event_check(const struct poll_event *event, uint32_t start, bool *ready)
+{
+	char c;
+	switch (event->type) {
+	case POLL_UART_READABLE:
+		*ready = uart_peekc(&c);
+		return true;
+	case POLL_TIMEOUT:
+		*ready = event->arg == 0u || (int32_t)(scheduler_ticks() - start - event->arg) >= 0;
+		return true;
+	case POLL_THREAD_EXIT:
+		return scheduler_thread_exited(event->arg, ready);
+	case POLL_PORT_READABLE:
+		return ipc_port_readable(event->arg, ready);
+	default:
+		return false;
+	}
+}
+
+/* Updates the ready flags, returns how many are set or -1 for an invalid descriptor. */
+static int32_t poll_scan(struct poll_event *events, uint32_t count, uint32_t start)
+{
+	int32_t ready_count = 0;
+	for (uint32_t i = 0; i < count; ++i) {
+		bool ready = false;
+		if (!event_check(&events[i], start, &ready)) {
+			return -1;
+		}
+		events[i].ready = ready ? 1u : 0u;
+		ready_count += ready ? 1 : 0;
+	}
+	return ready_count;
+}
+
+static void poll_report(struct poll_event *user, const struct poll_event *events, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; ++i) {
+		user[i].ready = events[i].ready;
+	}
+}
+
+static void poll_fire(poll_table_t *table, int32_t ready)
+{
+	for (uint32_t i = 0; i < table->count; ++i) {
+		list_remove_(&table->entries[i].link);
+	}
+	if (table->timed) {
+		list_remove_(&table->timer_link);
+	}
+
+	if (ready > 0) {
+		poll_report(table->user, table->events, table->count);
+	}
+	tcb_t *poller = scheduler_wake_first(&table->wait);
+	if (poller) {
+		poller->ctx_storage.r0 = (uint32_t)ready;
+	}
+	kmem_free(table, sizeof(*table));
+}
+
+/* Fires the table if any of its descriptors is ready now. */
+static void poll_try_fire(poll_table_t *table)
+{
+	int32_t ready = poll_scan(table->events, table->count, table->start);
+	if (ready != 0) {
+		// Ungültig geworden (z.B. Handle recycelt) endet wie ein ungültiger Aufruf mit -1
+		poll_fire(table, ready);
+	}
+}
+
+void poll_init(void)
+{
+	for (unsigned int i = 0; i < POLL_QUEUE_PORTS + IPC_PORT_MAX; ++i) {
+		g_poll_queues[i] = (list_node){ &g_poll_queues[i], &g_poll_queues[i] };
+	}
+}
+
+poll_result_t poll_wait(struct poll_event *events, uint32_t count, uint32_t *ready)
+{
+	if (count == 0u || count > POLL_MAX_EVENTS || ((uint32_t)events & 3u) != 0u ||
+	    !user_buffer_valid((uint32_t)events, count * sizeof(*events))) {
+		return POLL_INVALID;
+	}
+
+	// Nur diese Kopie wird geprüft, der Thread kann sein Array währenddessen ändern
+	struct poll_event copy[POLL_MAX_EVENTS];
+	memcpy(copy, events, count * sizeof(*events));
+
+	uint32_t start	     = scheduler_ticks();
+	int32_t	 ready_count = poll_scan(copy, count, start);
+	if (ready_count < 0) {
+		return POLL_INVALID;
+	}
+	if (ready_count > 0) {
+		poll_report(events, copy, count);
+		*ready = (uint32_t)ready_count;
+		return POLL_DONE;
+	}
+
+	poll_table_t *table = kmem_alloc(sizeof(*table));
+	if (!table) {
+		return POLL_INVALID;
+	}
+	table->wait  = (list_node){ &table->wait, &table->wait };
+	table->user  = events;
+	table->count = count;
+	table->start = start;
+	table->timed = false;
+	memcpy(table->events, copy, count * sizeof(*events));
+
+	for (uint32_t i = 0; i < count; ++i) {
+		poll_entry_t *entry = &table->entries[i];
+		entry->link	    = (list_node){ &entry->link, &entry->link };
+		entry->table	    = table;
+
+		if (copy[i].type == POLL_TIMEOUT) {
+			uint32_t deadline = start + copy[i].arg;
+			if (!table->timed || (int32_t)(deadline - table->deadline) < 0) {
+				table->deadline = deadline;
+			}
+			table->timed = true;
+			continue;
+		}
+
+		list_node *queue = poll_queue(copy[i].type, copy[i].arg);
+		bool	   listed = false;
+		for (uint32_t j = 0; j < i; ++j) {
+			listed = listed || poll_queue(copy[j].type, copy[j].arg) == queue;
+		}
+		if (!listed) {
+			list_add_last(queue, &entry->link);
+		}
+	}
+	if (table->timed) {
+		poll_timer_insert(table);
+	}
+
+	if (!scheduler_block_current(&table->wait, T_BLOCKED)) {
+		poll_fire(table, 0);
+		return POLL_INVALID;
+	}
+	*ready = 0u;
+	return POLL_BLOCKED;
+}
+
+/* Called by a source that might have become ready, wakes the pollers it made ready. */
+void poll_notify(uint32_t type, uint32_t arg)
+{
+	list_node *queue = poll_queue(type, arg);
+	if (!queue) {
+		return;
+	}
+
+	// Ein Table steht höchstens einmal in jeder Queue, poll_fire entfernt also nie node->next
+	list_node *node = queue->next;
+	while (node != queue) {
+		list_node *next = node->next;
+		poll_try_fire(((poll_entry_t *)node)->table);
+		node = next;
+	}
+}
+
+void poll_tick(void)
+{
+	// Ein abgelaufener Table feuert immer und verlässt damit g_poll_timers, sein POLL_TIMEOUT ist bereit
+	list_node *node;
+	while ((node = list_get_first(&g_poll_timers)) != NULL) {
+		poll_table_t *table = table_from_timer_link(node);
+		if (!deadline_passed(table->deadline)) {
+			break;
+		}
+		poll_fire(table, poll_scan(table->events, table->count, table->start));
+	}
+}
+
+/* Earliest poll timeout, so the tickless timer wakes up for it. */
+bool poll_next_deadline(uint32_t *tick)
+{
+	list_node *head = list_get_first(&g_poll_timers);
+	if (!head) {
+		return false;
+	}
+	*tick = table_from_timer_link(head)->deadline;
+	return true;
+}
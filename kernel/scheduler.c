@@ -1,8 +1,16 @@
 #include <kernel/scheduler.h>
+#include <kernel/smp.h>
+#include <kernel/vfp.h>
+#include <kernel/kmem.h>
+#include <kernel/pmu.h>
+#include <kernel/poll.h>
+#include <kernel/timepage.h>
+#include <kernel/uring.h>
 
 #include <syscall.h>
 
 #include <arch/bsp/systimer.h>
+#include <arch/bsp/irq.h>
 #include <arch/bsp/uart.h>
 
 #include <lib/kprintf.h>
@@ -11,49 +19,739 @@
 #include <stddef.h>
 
 #include <lib/list.h>
+#include <lib/bitmap.h>
 
 #define USER_MODE_CPSR 0b10000
 #define FIQ_DISABLE    (1u << 6)
 
+#define RUNQUEUE_LEVELS        (THREAD_PRIORITY_MAX + 1u)
+#define ALL_CPUS               ((1u << SMP_CORES) - 1u)
+
+#if SCHED_POLICY == SCHED_POLICY_MLFQ
+/*
+ * A thread sinks one level each time it uses up the quantum of its current
+ * level and rises one level when it blocks voluntarily. Deeper levels get
+ * longer quanta. Every MLFQ_BOOST_TICKS all threads return to their base
+ * level so CPU-bound threads cannot starve.
+ */
+#define MLFQ_DEPTH       4u
+#define MLFQ_BOOST_TICKS 32u
+static const uint8_t g_mlfq_quantum[MLFQ_DEPTH] = { 1u, 2u, 4u, 8u };
+#endif
+
+/*
+ * Real-time threads are dispatched EDF ahead of every policy below. Ready
+ * jobs wait in the edf queue of their run queue sorted by absolute deadline,
+ * finished or throttled ones in g_release_queue sorted by their next
+ * release. Releases and budget exhaustion are driven by systimer channel
+ * RT_TIMER_CHANNEL.
+ * Admission keeps the sum of budget / min(deadline, period) at or below 1,
+ * measured in 1/RT_UTIL_SCALE. All RT threads run on RT_CPU, the core that
+ * receives the systimer interrupts.
+ */
+#define RT_TIMER_CHANNEL 3u
+#define RT_CPU           0u
+#define RT_UTIL_SCALE    1024u
+#define RT_MAX_PERIOD_US (1u << 21)
+#define RT_MIN_EVENT_US  10u
+
+#if SCHED_POLICY == SCHED_POLICY_FAIR
+/*
+ * Ready threads live in a binary min-heap ordered by vruntime, the CPU time
+ * in microseconds scaled by FAIR_WEIGHT_UNIT / weight. Each priority step
+ * changes the weight by 1.25x, THREAD_PRIORITY_DEFAULT has weight 1024.
+ * Waking threads get at most FAIR_WAKEUP_CREDIT of vruntime ahead of the
+ * current minimum, so a long sleep does not buy a long monopoly.
+ */
+#define FAIR_WEIGHT_UNIT   1024u
+#define FAIR_WAKEUP_CREDIT (TIMER_INTERVAL / 2u)
+#define FAIR_WAKEUP_GRANULARITY (FAIR_WAKEUP_CREDIT / 2u)
+#define FAIR_MAX_DELTA_US  ((1u << 22) - 1u)
+static const uint32_t g_fair_weight[THREAD_PRIORITY_MAX + 1u] = {
+    36, 45, 56, 70, 88, 110, 137, 172, 215, 268, 336, 419, 524, 655, 819, 1024,
+    1280, 1600, 2000, 2500, 3125, 3906, 4883, 6104, 7629, 9537, 11921, 14901, 18626, 23283, 29104, 36380,
+};
+#endif
+
 extern void main(void) __attribute__((weak));
 
-static tcb_t g_threads[MAX_THREADS];
-extern uint8_t _thread_stack_pool_base[];
-static unsigned int g_rr_cursor = 1;
-tcb_t *g_current = NULL;
-static tcb_t *g_idle_tcb = NULL;
+/*
+ * Hot scheduling state, kept apart from the context frames in g_threads so
+ * the run queue code only touches this compact array. Index i belongs to
+ * g_threads[i]. A thread sits on at most one list at a time (ready queue of
+ * its level, the sleep queue or one of the input wait lists), so a single
+ * link is enough. wake_tick is an absolute tick count, see g_sleep_queue, and
+ * doubles as the timeout of a T_SLEEPING thread on g_read_wait_list. Such a
+ * reader is additionally on g_read_timers through timer_link. cpu is the
+ * core whose run queue the thread uses. woken_at is the systimer value at the
+ * last wakeup by an interrupt, measured until the next dispatch while
+ * wake_pending is set. With MLFQ a thread with demotion != 0 is also on
+ * g_mlfq_demoted through demoted_link, so the boost only visits those.
+ */
+typedef struct sched_entity {
+    list_node link;
+    list_node timer_link;
+    uint8_t   state;
+    uint8_t   level;
+    uint8_t   priority;
+    uint8_t   demotion;
+    uint8_t   slice_used;
+    uint8_t   rt;
+    uint8_t   cpu;
+    uint8_t   wake_pending;
+    uint32_t  wake_tick;
+    uint32_t  woken_at;
+#if SCHED_POLICY == SCHED_POLICY_FAIR
+    uint64_t  vruntime;
+#endif
+#if SCHED_POLICY == SCHED_POLICY_MLFQ
+    list_node demoted_link;
+#endif
+} sched_entity_t;
+
+typedef struct rt_entity {
+    uint32_t period;
+    uint32_t budget;
+    uint32_t deadline;
+    uint32_t utilization;
+    uint32_t release;
+    uint32_t abs_deadline;
+    uint32_t budget_left;
+    uint32_t deadline_misses;
+} rt_entity_t;
+
+/*
+ * Every core has its own run queue and its own idle thread in slot cpu.
+ * Cores only dispatch from their own queue and steal from the busiest other
+ * queue when it is empty, see runqueue_steal(). All queues are protected by
+ * the kernel lock, see kernel/smp.c.
+ */
+typedef struct runqueue {
+#if SCHED_POLICY == SCHED_POLICY_FAIR
+    uint16_t     fair_heap[MAX_THREADS];
+    unsigned int fair_heap_size;
+    uint64_t     min_vruntime;
+#else
+    list_node    ready[RUNQUEUE_LEVELS];
+    uint32_t     level_words[BITMAP_WORDS(RUNQUEUE_LEVELS)];
+    bitmap_t     levels;
+#endif
+    list_node    edf;
+    unsigned int nr_ready;
+#if SCHED_POLICY == SCHED_POLICY_MLFQ
+    bool         slice_expired;
+#endif
+} runqueue_t;
+
+static_assert(sizeof(context_frame_t) == CTX_FRAME_SIZE, "vector_table.S relies on the frame size");
+static_assert(offsetof(tcb_t, ctx_storage) % 8u == 0u, "kernel stack top must be 8 byte aligned");
+static_assert(KMEM_MIN_BLOCK == THREAD_STACK_MIN && KMEM_MAX_BLOCK == THREAD_STACK_MAX,
+              "stack size classes are part of the syscall interface");
+static_assert(sizeof(tcb_t) <= KERNEL_STACK_SIZE + 256u, "a TCB fits the 1280 byte kmem class");
+
+static tcb_t *g_threads[MAX_THREADS];
+static tcb_t g_idle_threads[SMP_CORES];
+static sched_entity_t g_sched[MAX_THREADS];
+static rt_entity_t g_rt[MAX_THREADS];
+static runqueue_t g_rq[SMP_CORES];
+tcb_t *g_current_cpu[SMP_CORES];
+static uint32_t g_idle_cpus = ALL_CPUS;
+static uint32_t g_need_resched = 0u;
+// Thread, den der nächste pick_next dieses Kerns direkt nimmt, siehe scheduler_handoff()
+static tcb_t *g_handoff[SMP_CORES];
 static list_node g_getc_wait_list_head = { &g_getc_wait_list_head, &g_getc_wait_list_head };
+static list_node g_sleep_queue = { &g_sleep_queue, &g_sleep_queue };
+// syscall_read Leser, T_SLEEPING mit Timeout in wake_tick, sonst T_WAITING_IO
+static list_node g_read_wait_list = { &g_read_wait_list, &g_read_wait_list };
+// Die Leser mit Timeout noch einmal, nach wake_tick sortiert wie g_sleep_queue
+static list_node g_read_timers = { &g_read_timers, &g_read_timers };
+static uint32_t g_tick_count = 0u;
+static bool g_tick_stopped = false;
+static uint32_t g_idle_since = 0u;
+static uint32_t g_tick_deadline = 0u;
+static scheduler_stats_t g_stats;
+static kernel_context_t g_boot_kctx[SMP_CORES];
+// PMU Stand beim Eintritt des Tick IRQs und der Thread, zu dem dieser Tick umschaltet
+static uint32_t g_tick_entry_cycles[SMP_CORES];
+static bool g_tick_entry_valid[SMP_CORES];
+static tcb_t *g_tick_switch_to[SMP_CORES];
+#if SCHED_POLICY == SCHED_POLICY_MLFQ
+static uint32_t g_last_boost = 0u;
+static list_node g_mlfq_demoted = { &g_mlfq_demoted, &g_mlfq_demoted };
+#endif
 
-static uint8_t *thread_stack_base(unsigned int idx)
+static list_node g_release_queue = { &g_release_queue, &g_release_queue };
+static uint32_t g_rt_utilization = 0u;
+static bool g_rt_timer_armed = false;
+/*
+ * Handles are generation << THREAD_SLOT_BITS | slot. The generation of a slot
+ * grows with every thread created in it and skips 0, which marks a slot that
+ * never had a thread. Slots are handed out round-robin
+ * from g_next_slot so a freed slot, and the exit status kept for it, lasts as
+ * long as possible before reuse.
+ */
+#define THREAD_SLOT_BITS 10u
+#define THREAD_GEN_MASK  (0xFFFFFFFFu >> THREAD_SLOT_BITS)
+static_assert(MAX_THREADS == (1u << THREAD_SLOT_BITS), "handle layout");
+
+bitmap_create(g_free_slots, MAX_THREADS);
+static unsigned int g_next_slot = 0u;
+static uint32_t g_generation[MAX_THREADS];
+static int32_t g_exit_status[MAX_THREADS];
+void list_node_init(list_node *node)
 {
-    return _thread_stack_pool_base + ((size_t)idx * STACK_SIZE);
+    node->next = node;
+    node->prev = node;
 }
 
-static uint8_t *thread_stack_top(unsigned int idx)
+static unsigned int thread_index(const tcb_t *thread)
 {
-    uint8_t *base = thread_stack_base(idx);
-    return base + STACK_SIZE;
+    return thread->slot;
 }
-void list_node_init(list_node *node)
+
+static uint32_t thread_handle(const tcb_t *thread)
 {
-    node->next = node;
-    node->prev = node;
+    return (g_generation[thread->slot] << THREAD_SLOT_BITS) | thread->slot;
+}
+
+static sched_entity_t *sched_entity(const tcb_t *thread)
+{
+    return &g_sched[thread_index(thread)];
+}
+
+static bool is_idle_thread(const tcb_t *thread)
+{
+    return thread_index(thread) < SMP_CORES;
+}
+
+static bool thread_is_current(const tcb_t *thread)
+{
+    for (unsigned int cpu = 0; cpu < SMP_CORES; ++cpu) {
+        if (g_current_cpu[cpu] == thread) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static sched_entity_t *sched_entity_from_link(list_node *node)
+{
+    return (sched_entity_t *)((char *)node - offsetof(sched_entity_t, link));
+}
+
+static sched_entity_t *sched_entity_from_timer_link(list_node *node)
+{
+    return (sched_entity_t *)((char *)node - offsetof(sched_entity_t, timer_link));
+}
+
+static tcb_t *tcb_from_link(list_node *node)
+{
+    return g_threads[sched_entity_from_link(node) - g_sched];
+}
+
+static uint8_t level_for_priority(uint32_t priority)
+{
+    return (uint8_t)(THREAD_PRIORITY_MAX - priority);
+}
+
+static void entity_update_level(sched_entity_t *se)
+{
+    uint32_t level = level_for_priority(se->priority) + se->demotion;
+    se->level = (uint8_t)(level < RUNQUEUE_LEVELS ? level : RUNQUEUE_LEVELS - 1u);
+}
+
+static bool deadline_reached(uint32_t deadline, uint32_t now)
+{
+    return (int32_t)(deadline - now) <= 0;
+}
+
+static void policy_on_wake(const runqueue_t *rq, sched_entity_t *se);
+static bool policy_wakeup_preempts(const sched_entity_t *woken);
+
+#if SCHED_POLICY == SCHED_POLICY_FAIR
+static bool fair_heap_less(const runqueue_t *rq, unsigned int a, unsigned int b)
+{
+    return g_sched[rq->fair_heap[a]].vruntime < g_sched[rq->fair_heap[b]].vruntime;
+}
+
+static void fair_heap_swap(runqueue_t *rq, unsigned int a, unsigned int b)
+{
+    uint16_t tmp = rq->fair_heap[a];
+    rq->fair_heap[a] = rq->fair_heap[b];
+    rq->fair_heap[b] = tmp;
+}
+
+static void policy_queue_push(runqueue_t *rq, tcb_t *thread)
+{
+    sched_entity_t *se = sched_entity(thread);
+    if (se->state != T_RUNNING) {
+        policy_on_wake(rq, se);
+    }
+    se->state = T_RUNNING;
+    rq->nr_ready++;
+
+    unsigned int pos = rq->fair_heap_size++;
+    rq->fair_heap[pos] = (uint16_t)thread_index(thread);
+    while (pos > 0u && fair_heap_less(rq, pos, (pos - 1u) / 2u)) {
+        fair_heap_swap(rq, pos, (pos - 1u) / 2u);
+        pos = (pos - 1u) / 2u;
+    }
+}
+
+static tcb_t *policy_queue_pop(runqueue_t *rq)
+{
+    if (rq->fair_heap_size == 0u) {
+        return NULL;
+    }
+
+    unsigned int idx = rq->fair_heap[0];
+    rq->fair_heap[0] = rq->fair_heap[--rq->fair_heap_size];
+    rq->nr_ready--;
+
+    unsigned int pos = 0u;
+    for (;;) {
+        unsigned int child = 2u * pos + 1u;
+        if (child >= rq->fair_heap_size) {
+            break;
+        }
+        if (child + 1u < rq->fair_heap_size && fair_heap_less(rq, child + 1u, child)) {
+            child++;
+        }
+        if (!fair_heap_less(rq, child, pos)) {
+            break;
+        }
+        fair_heap_swap(rq, pos, child);
+        pos = child;
+    }
+
+    if (g_sched[idx].vruntime > rq->min_vruntime) {
+        rq->min_vruntime = g_sched[idx].vruntime;
+    }
+    return g_threads[idx];
+}
+
+static bool policy_queue_is_empty(const runqueue_t *rq)
+{
+    return rq->fair_heap_size == 0u;
+}
+#else
+static void policy_queue_push(runqueue_t *rq, tcb_t *thread)
+{
+    sched_entity_t *se = sched_entity(thread);
+    if (se->state != T_RUNNING) {
+        policy_on_wake(rq, se);
+    }
+    se->state = T_RUNNING;
+    rq->nr_ready++;
+    list_add_last(&rq->ready[se->level], &se->link);
+    bitmap_set(&rq->levels, se->level);
+}
+
+static tcb_t *policy_queue_pop(runqueue_t *rq)
+{
+    int level = bitmap_find_first(&rq->levels);
+    if (level < 0) {
+        return NULL;
+    }
+
+    list_node *node = list_remove_first(&rq->ready[level]);
+    if (list_is_empty(&rq->ready[level])) {
+        bitmap_clear(&rq->levels, (unsigned int)level);
+    }
+    rq->nr_ready--;
+    list_node_init(node);
+    return tcb_from_link(node);
+}
+
+[[maybe_unused]] static void runqueue_remove(runqueue_t *rq, sched_entity_t *se)
+{
+    list_remove_(&se->link);
+    list_node_init(&se->link);
+    rq->nr_ready--;
+    if (list_is_empty(&rq->ready[se->level])) {
+        bitmap_clear(&rq->levels, se->level);
+    }
+}
+
+static bool policy_queue_is_empty(const runqueue_t *rq)
+{
+    return bitmap_is_empty(&rq->levels);
+}
+#endif
+
+/* A stolen thread keeps its lag behind the old queue's minimum vruntime. */
+static void policy_migrate([[maybe_unused]] const runqueue_t *from, [[maybe_unused]] const runqueue_t *to,
+                           [[maybe_unused]] sched_entity_t *se)
+{
+#if SCHED_POLICY == SCHED_POLICY_FAIR
+    uint64_t lag = se->vruntime > from->min_vruntime ? se->vruntime - from->min_vruntime : 0u;
+    se->vruntime = to->min_vruntime + lag;
+#endif
+}
+
+static rt_entity_t *rt_entity(const sched_entity_t *se)
+{
+    return &g_rt[se - g_sched];
+}
+
+static uint32_t rt_key(list_node *node, bool by_deadline)
+{
+    rt_entity_t *rt = rt_entity(sched_entity_from_link(node));
+    return by_deadline ? rt->abs_deadline : rt->release;
+}
+
+static void rt_queue_insert(list_node *head, sched_entity_t *se, bool by_deadline)
+{
+    uint32_t key = rt_key(&se->link, by_deadline);
+    list_node *pos = head->prev;
+    while (pos != head && !deadline_reached(rt_key(pos, by_deadline), key)) {
+        pos = pos->prev;
+    }
+    list_add_(&se->link, pos);
+}
+
+static void rt_start_job(rt_entity_t *rt, uint32_t release)
+{
+    rt->release = release;
+    rt->abs_deadline = release + rt->deadline;
+    rt->budget_left = rt->budget;
+}
+
+/*
+ * Ends the current job of a running RT thread. If the next release already
+ * passed (the job overran), the thread stays runnable with a fresh job,
+ * otherwise it waits on the release queue.
+ */
+static void rt_defer(sched_entity_t *se, uint32_t now)
+{
+    rt_entity_t *rt = rt_entity(se);
+    uint32_t next = rt->release + rt->period;
+    if (deadline_reached(next, now)) {
+        next += ((now - next) / rt->period) * rt->period;
+        rt_start_job(rt, next);
+        return;
+    }
+
+    rt->release = next;
+    se->state = T_RT_WAITING;
+    rt_queue_insert(&g_release_queue, se, false);
+}
+
+/* Queues a thread on its own core without telling anyone, see runqueue_push(). */
+static void runqueue_enqueue(tcb_t *thread)
+{
+    sched_entity_t *se = sched_entity(thread);
+    runqueue_t *rq = &g_rq[se->cpu];
+    if (!se->rt) {
+        policy_queue_push(rq, thread);
+        return;
+    }
+
+    se->state = T_RUNNING;
+    rt_queue_insert(&rq->edf, se, true);
+}
+
+/*
+ * Asks cpu to reschedule on its way out of the kernel. For the calling core
+ * the handlers check scheduler_need_resched(), other cores get an IPI.
+ */
+static void runqueue_resched_cpu(unsigned int cpu)
+{
+    if (cpu == smp_cpu_id()) {
+        g_need_resched |= 1u << cpu;
+        return;
+    }
+    smp_send_ipi(cpu, SMP_IPI_RESCHEDULE);
+}
+
+/*
+ * Queues a thread that just became runnable and makes sure a core picks it
+ * up: its own core if the thread should preempt what runs there, see
+ * policy_wakeup_preempts(), otherwise any idle core, which then steals it.
+ */
+static void runqueue_push(tcb_t *thread)
+{
+    runqueue_enqueue(thread);
+
+    sched_entity_t *se = sched_entity(thread);
+    if (policy_wakeup_preempts(se)) {
+        runqueue_resched_cpu(se->cpu);
+        return;
+    }
+
+    uint32_t idle = g_idle_cpus & ~(1u << smp_cpu_id());
+    if (idle != 0u) {
+        smp_send_ipi((unsigned int)__builtin_ctz(idle), SMP_IPI_RESCHEDULE);
+    }
+}
+
+static tcb_t *runqueue_pop(runqueue_t *rq)
+{
+    list_node *node = list_remove_first(&rq->edf);
+    if (!node) {
+        return policy_queue_pop(rq);
+    }
+
+    list_node_init(node);
+    return tcb_from_link(node);
+}
+
+static bool runqueue_is_empty(runqueue_t *rq)
+{
+    return list_is_empty(&rq->edf) && policy_queue_is_empty(rq);
+}
+
+/* Takes the best thread of the core with the most waiting threads. */
+static tcb_t *runqueue_steal(unsigned int cpu)
+{
+    runqueue_t *victim = NULL;
+    for (unsigned int i = 1; i < SMP_CORES; ++i) {
+        runqueue_t *rq = &g_rq[(cpu + i) % SMP_CORES];
+        if (rq->nr_ready > (victim ? victim->nr_ready : 0u)) {
+            victim = rq;
+        }
+    }
+
+    if (!victim) {
+        return NULL;
+    }
+
+    tcb_t *thread = policy_queue_pop(victim);
+    sched_entity_t *se = sched_entity(thread);
+    policy_migrate(victim, &g_rq[cpu], se);
+    se->cpu = (uint8_t)cpu;
+    g_stats.steals++;
+    return thread;
+}
+
+/* Waiting threads plus the running one, if the core is not idle. */
+static unsigned int runqueue_load(unsigned int cpu)
+{
+    return g_rq[cpu].nr_ready + ((g_idle_cpus & (1u << cpu)) ? 0u : 1u);
+}
+
+/* New threads go to the core with the least load, the calling one on ties. */
+static unsigned int runqueue_select_cpu(void)
+{
+    unsigned int best = smp_cpu_id();
+    for (unsigned int cpu = 0; cpu < SMP_CORES; ++cpu) {
+        if (runqueue_load(cpu) < runqueue_load(best)) {
+            best = cpu;
+        }
+    }
+    return best;
+}
+
+#if SCHED_POLICY == SCHED_POLICY_MLFQ
+static sched_entity_t *sched_entity_from_demoted_link(list_node *node)
+{
+    return (sched_entity_t *)((char *)node - offsetof(sched_entity_t, demoted_link));
+}
+
+// RT Threads sinken nie, auf g_mlfq_demoted stehen also nur normale Threads
+static void mlfq_boost(void)
+{
+    list_node *node;
+    while ((node = list_remove_first(&g_mlfq_demoted)) != NULL) {
+        sched_entity_t *se = sched_entity_from_demoted_link(node);
+        tcb_t *thread = g_threads[se - g_sched];
+
+        bool queued = se->state == T_RUNNING && !thread_is_current(thread);
+        if (queued) {
+            runqueue_remove(&g_rq[se->cpu], se);
+        }
+        se->demotion = 0u;
+        se->slice_used = 0u;
+        entity_update_level(se);
+        if (queued) {
+            runqueue_enqueue(thread);
+        }
+    }
+    g_last_boost = g_tick_count;
+}
+#endif
+
+/* Charges one tick to the thread running on this core. */
+static void policy_on_tick(void)
+{
+#if SCHED_POLICY == SCHED_POLICY_MLFQ
+    if (!g_current || is_idle_thread(g_current)) {
+        return;
+    }
+
+    sched_entity_t *se = sched_entity(g_current);
+    if (se->state != T_RUNNING || se->rt || ++se->slice_used < g_mlfq_quantum[se->demotion]) {
+        return;
+    }
+
+    se->slice_used = 0u;
+    if (se->demotion + 1u < MLFQ_DEPTH) {
+        if (se->demotion++ == 0u) {
+            list_add_last(&g_mlfq_demoted, &se->demoted_link);
+        }
+        entity_update_level(se);
+    }
+    g_rq[smp_cpu_id()].slice_expired = true;
+#endif
+}
+
+static void policy_on_wake([[maybe_unused]] const runqueue_t *rq, [[maybe_unused]] sched_entity_t *se)
+{
+#if SCHED_POLICY == SCHED_POLICY_FAIR
+    uint64_t floor = rq->min_vruntime > FAIR_WAKEUP_CREDIT ? rq->min_vruntime - FAIR_WAKEUP_CREDIT : 0u;
+    if (se->vruntime < floor) {
+        se->vruntime = floor;
+    }
+#endif
+}
+
+/* Charges the CPU time since the last dispatch to the outgoing thread. */
+static void policy_account(tcb_t *thread, uint32_t now)
+{
+    uint32_t delta = now - thread->dispatched_at;
+    thread->runtime_us += delta;
+    thread->dispatched_at = now;
+    if (sched_entity(thread)->rt) {
+        rt_entity_t *rt = rt_entity(sched_entity(thread));
+        rt->budget_left -= delta < rt->budget_left ? delta : rt->budget_left;
+        return;
+    }
+#if SCHED_POLICY == SCHED_POLICY_FAIR
+    if (delta > FAIR_MAX_DELTA_US) {
+        delta = FAIR_MAX_DELTA_US;
+    }
+    sched_entity_t *se = sched_entity(thread);
+    se->vruntime += (delta * FAIR_WEIGHT_UNIT) / g_fair_weight[se->priority];
+#endif
+}
+
+static void policy_on_block([[maybe_unused]] sched_entity_t *se)
+{
+#if SCHED_POLICY == SCHED_POLICY_MLFQ
+    se->slice_used = 0u;
+    if (se->demotion > 0u) {
+        if (--se->demotion == 0u) {
+            list_remove_(&se->demoted_link);
+        }
+        entity_update_level(se);
+    }
+#endif
+}
+
+/* Whether the runnable current thread may go on instead of being requeued. */
+static bool policy_keep_current(runqueue_t *rq)
+{
+    sched_entity_t *current = sched_entity(g_current);
+    list_node *edf_head = list_get_first(&rq->edf);
+    if (current->rt) {
+        return !edf_head || (int32_t)(rt_key(edf_head, true) - rt_entity(current)->abs_deadline) >= 0;
+    }
+    if (edf_head) {
+        return false;
+    }
+
+#if SCHED_POLICY == SCHED_POLICY_MLFQ
+    bool expired = rq->slice_expired;
+    rq->slice_expired = false;
+    if (expired) {
+        return false;
+    }
+
+    int best = bitmap_find_first(&rq->levels);
+    return best < 0 || (unsigned int)best >= current->level;
+#elif SCHED_POLICY == SCHED_POLICY_FAIR
+    return policy_queue_is_empty(rq) || g_sched[rq->fair_heap[0]].vruntime >= current->vruntime;
+#else
+    return false;
+#endif
+}
+
+/*
+ * Whether a thread that just became runnable should run ahead of the current
+ * thread of its core right away instead of at the next tick. Idle always
+ * yields, EDF order decides among real-time threads, and otherwise the policy
+ * compares the two threads the way the run queue would. FAIR needs a lead of
+ * FAIR_WAKEUP_GRANULARITY so wakeups do not switch for every few microseconds.
+ */
+static bool policy_wakeup_preempts(const sched_entity_t *woken)
+{
+    tcb_t *running = g_current_cpu[woken->cpu];
+    if (!running || is_idle_thread(running)) {
+        return true;
+    }
+
+    const sched_entity_t *current = sched_entity(running);
+    if (current->rt) {
+        return woken->rt &&
+               (int32_t)(rt_entity(woken)->abs_deadline - rt_entity(current)->abs_deadline) < 0;
+    }
+    if (woken->rt) {
+        return true;
+    }
+
+#if SCHED_POLICY == SCHED_POLICY_FAIR
+    return woken->vruntime + FAIR_WAKEUP_GRANULARITY < current->vruntime;
+#else
+    return woken->level < current->level;
+#endif
+}
+
+/*
+ * The sleep queue is sorted by wake_tick. Equal deadlines keep FIFO order, and
+ * the scan starts at the tail because new sleepers usually wake last.
+ */
+static void sleep_queue_insert(sched_entity_t *se)
+{
+    list_node *pos = g_sleep_queue.prev;
+    while (pos != &g_sleep_queue && !deadline_reached(sched_entity_from_link(pos)->wake_tick, se->wake_tick)) {
+        pos = pos->prev;
+    }
+    list_add_(&se->link, pos);
 }
 
-static tcb_t *tcb_from_wait_node(list_node *node)
+static void read_timer_insert(sched_entity_t *se)
 {
-    return (tcb_t *)((char *)node - offsetof(tcb_t, wait_node));
+    list_node *pos = g_read_timers.prev;
+    while (pos != &g_read_timers && !deadline_reached(sched_entity_from_timer_link(pos)->wake_tick, se->wake_tick)) {
+        pos = pos->prev;
+    }
+    list_add_(&se->timer_link, pos);
 }
 
 
+/*
+ * Idle threads run in SVC mode on their kernel stack and are entered with the
+ * kernel lock held. Between interrupts they zero freed memory for kmem so
+ * thread creation finds clean stacks, once nothing is left they wait with
+ * wfi. The IRQ is taken at cpsie and may switch away from here like from any
+ * other kernel path.
+ */
 __attribute__((noreturn)) static void idle_thread_fn(void)
 {
     for (;;) {
-        asm volatile ("wfi");
+        if (kmem_scrub()) {
+            scheduler_preempt_point();
+            continue;
+        }
+
+        smp_kernel_unlock();
+        asm volatile ("wfi\n"
+                      "cpsie i\n"
+                      "nop\n"
+                      "cpsid i" ::: "memory");
+        smp_kernel_lock();
     }
     __builtin_unreachable();
 }
 
+/* The first switch to a thread enters ret_from_fork with its empty kernel stack. */
+static void thread_init_kernel_context(tcb_t *thread)
+{
+    memset(&thread->kctx, 0, sizeof(kernel_context_t));
+    thread->kctx.sp = (uint32_t)&thread->ctx_storage;
+    thread->kctx.lr = (uint32_t)ret_from_fork;
+}
+
 static void thread_trampoline(void (*func)(void *), void *arg)
 {
     func(arg);
@@ -85,79 +783,194 @@ static void create_initial_user_thread(void)
 
 void scheduler_init(void)
 {
-    memset(_thread_stack_pool_base, 0, STACK_SIZE * MAX_THREADS);
-
-    for (int i = 0; i < MAX_THREADS; ++i) {
-        g_threads[i].state = T_UNUSED;
-        g_threads[i].stack_base = thread_stack_base(i);
-        g_threads[i].stack_top  = thread_stack_top(i);
-        memset(&g_threads[i].ctx_storage, 0, sizeof(context_frame_t));
-        g_threads[i].sleep_ticks = 0u;
-        list_node_init(&g_threads[i].wait_node);
+    for (unsigned int cpu = 0; cpu < SMP_CORES; ++cpu) {
+        runqueue_t *rq = &g_rq[cpu];
+#if SCHED_POLICY != SCHED_POLICY_FAIR
+        for (unsigned int level = 0; level < RUNQUEUE_LEVELS; ++level) {
+            list_node_init(&rq->ready[level]);
+        }
+        rq->levels = (bitmap_t){ 0u, rq->level_words };
+#endif
+        list_node_init(&rq->edf);
     }
 
-    g_idle_tcb = &g_threads[0];
-    g_idle_tcb->state = T_RUNNING;
-    memset(g_idle_tcb->stack_top, 0, STACK_SIZE);
-    g_idle_tcb->sleep_ticks = 0u;
-    list_node_init(&g_idle_tcb->wait_node);
+    kmem_init();
 
-    g_idle_tcb->ctx_storage.sp_usr   = (uint32_t)g_idle_tcb->stack_top;
-    g_idle_tcb->ctx_storage.lr_exc   = (uint32_t)idle_thread_fn + 4;
-    g_idle_tcb->ctx_storage.cpsr_usr = USER_MODE_CPSR | FIQ_DISABLE;
+    for (unsigned int i = 0; i < MAX_THREADS; ++i) {
+        g_threads[i] = NULL;
+        g_sched[i].state = T_UNUSED;
+        g_sched[i].priority = THREAD_PRIORITY_DEFAULT;
+        g_sched[i].demotion = 0u;
+        g_sched[i].slice_used = 0u;
+        g_sched[i].rt = 0u;
+        g_sched[i].cpu = 0u;
+        entity_update_level(&g_sched[i]);
+        g_sched[i].wake_tick = 0u;
+        g_sched[i].wake_pending = 0u;
+        list_node_init(&g_sched[i].link);
+        if (i >= SMP_CORES) {
+            bitmap_set(&g_free_slots, i);
+        }
+    }
+
+    for (unsigned int cpu = 0; cpu < SMP_CORES; ++cpu) {
+        tcb_t *idle = &g_idle_threads[cpu];
+        memset(idle, 0, sizeof(tcb_t));
+        idle->slot = cpu;
+        g_threads[cpu] = idle;
+        g_sched[cpu].state = T_RUNNING;
+        g_sched[cpu].cpu = (uint8_t)cpu;
+        thread_init_kernel_context(idle);
+        idle->kctx.lr = (uint32_t)idle_thread_fn;
+    }
 
     create_initial_user_thread();
 }
 
 void scheduler_pick_next(void)
 {
-    for (unsigned int scanned = 0; scanned < MAX_THREADS; ++scanned) {
-        unsigned int idx = g_rr_cursor;
-        g_rr_cursor = (g_rr_cursor + 1u) % MAX_THREADS;
+    unsigned int cpu = smp_cpu_id();
+    runqueue_t *rq = &g_rq[cpu];
+    uint32_t now = systimer_now();
+    g_need_resched &= ~(1u << cpu);
+    if (g_current) {
+        policy_account(g_current, now);
+    }
 
-        tcb_t *candidate = &g_threads[idx];
-        if (candidate == g_idle_tcb) {
-            continue;
-        }
+    tcb_t *handoff = g_handoff[cpu];
+    g_handoff[cpu] = NULL;
 
-        if (candidate->state == T_RUNNING) {
-            g_current = candidate;
+    if (g_current && !is_idle_thread(g_current) && sched_entity(g_current)->state == T_RUNNING) {
+        if (!handoff && policy_keep_current(rq)) {
             return;
         }
+        runqueue_enqueue(g_current);
     }
 
-    g_current = g_idle_tcb;
-}
+    tcb_t *next = handoff ? handoff : runqueue_pop(rq);
+    if (!next) {
+        next = runqueue_steal(cpu);
+    }
 
-bool scheduler_thread_create(void(* func)(void *), const void * arg, unsigned int arg_size)
-{
-    tcb_t* t = NULL;
-    unsigned int temp_rr_cursor = g_rr_cursor;
-    for (unsigned int scanned = 0; scanned < MAX_THREADS; ++scanned) {
-        unsigned int idx = temp_rr_cursor;
-        temp_rr_cursor = (temp_rr_cursor + 1u) % MAX_THREADS;
+    if (next) {
+        g_idle_cpus &= ~(1u << cpu);
+    } else {
+        next = g_threads[cpu];
+        g_idle_cpus |= 1u << cpu;
+    }
+    if (next != g_current) {
+        vfp_switch(g_current, next);
+    }
+    g_current = next;
+    g_current->dispatched_at = now;
 
-        tcb_t *candidate = &g_threads[idx];
-        if (candidate == g_idle_tcb) {
-            continue;
+    sched_entity_t *se = sched_entity(next);
+    if (se->wake_pending) {
+        se->wake_pending = 0u;
+        uint32_t latency = now - se->woken_at;
+        g_stats.wakeups++;
+        g_stats.wakeup_latency_last_us = latency;
+        if (latency > g_stats.wakeup_latency_max_us) {
+            g_stats.wakeup_latency_max_us = latency;
         }
+    }
+}
 
-        if (candidate->state == T_UNUSED) {
-            t = candidate;
-            break;
+/*
+ * Runs in the thread that cpu_switch_to() resumed. If a tick made the switch
+ * to it on this core, the cycles since the tick's IRQ entry are recorded.
+ * Threads starting in ret_from_fork are not measured.
+ */
+static void tick_switch_done(void)
+{
+    unsigned int cpu = smp_cpu_id();
+    if (g_tick_switch_to[cpu] == g_current) {
+        uint32_t cycles = pmu_cycles() - g_tick_entry_cycles[cpu];
+        g_stats.tick_switch_cycles_last = cycles;
+        if (cycles > g_stats.tick_switch_cycles_max) {
+            g_stats.tick_switch_cycles_max = cycles;
         }
     }
-    if (!t) {
+    g_tick_switch_to[cpu] = NULL;
+}
+
+/*
+ * Picks the next thread of this core and switches to its kernel stack. Called
+ * with the kernel lock held. The lock is handed over with the switch, the
+ * thread switched to releases it on its way out of the kernel. Returns once
+ * the calling thread is dispatched again, possibly on another core.
+ */
+void scheduler_reschedule(void)
+{
+    tcb_t *prev = g_current;
+    scheduler_pick_next();
+    scheduler_arm_timer();
+
+    unsigned int cpu = smp_cpu_id();
+    tcb_t *next = g_current;
+    g_tick_switch_to[cpu] = prev != next && g_tick_entry_valid[cpu] ? next : NULL;
+    g_tick_entry_valid[cpu] = false;
+    if (prev != next) {
+        cpu_switch_to(&prev->kctx, &next->kctx);
+        tick_switch_done();
+    }
+}
+
+/*
+ * Explicit preemption point for long kernel paths. Drops the kernel lock and
+ * briefly unmasks IRQs, a pending interrupt may switch to another thread
+ * before this returns. Callers must not cache g_current or the core id across
+ * the call.
+ */
+void scheduler_preempt_point(void)
+{
+    smp_kernel_unlock();
+    __asm__ volatile("cpsie i\n"
+                     "nop\n"
+                     "cpsid i" ::: "memory");
+    smp_kernel_lock();
+}
+
+static tcb_t *thread_setup(void(* func)(void *), const void * arg, unsigned int arg_size,
+                           unsigned int stack_size)
+{
+    int slot = bitmap_find_next(&g_free_slots, g_next_slot);
+    if (slot < 0) {
         kprintf("Could not create thread.");
-        return false; 
+        return NULL; 
     }
 
-    if (arg_size > STACK_SIZE) {
+    size_t stack_bytes = kmem_block_size(stack_size);
+    if (stack_bytes == 0u) {
+        kprintf("Thread stack too large.\n");
+        return NULL;
+    }
+
+    if (arg_size > stack_bytes) {
         kprintf("Thread argument block too large.\n");
-        return false;
+        return NULL;
+    }
+
+    tcb_t *t = kmem_alloc(sizeof(tcb_t));
+    uint8_t *stack = kmem_alloc(stack_bytes);
+    if (!t || !stack) {
+        kmem_free(t, sizeof(tcb_t));
+        kmem_free(stack, stack_bytes);
+        kprintf("Out of thread memory.\n");
+        return NULL;
     }
 
-    memset(t->stack_top, 0, STACK_SIZE);
+    bitmap_clear(&g_free_slots, (unsigned int)slot);
+    g_threads[slot] = t;
+    g_next_slot = ((unsigned int)slot + 1u) % MAX_THREADS;
+    g_generation[slot] = (g_generation[slot] + 1u) & THREAD_GEN_MASK;
+    if (g_generation[slot] == 0u) {
+        g_generation[slot] = 1u;
+    }
+    t->slot = (unsigned int)slot;
+    list_node_init(&t->joiners);
+    t->stack_base = stack;
+    t->stack_top = stack + stack_bytes;
 
     uintptr_t sp = (uintptr_t)t->stack_top;
 
@@ -175,16 +988,180 @@ bool scheduler_thread_create(void(* func)(void *), const void * arg, unsigned in
     t->ctx_storage.sp_usr   = (uint32_t)sp;
     t->ctx_storage.lr_exc   = (uint32_t)thread_trampoline + 4;
     t->ctx_storage.cpsr_usr = USER_MODE_CPSR | FIQ_DISABLE;
-    t->state = T_RUNNING;
-    t->sleep_ticks = 0u;
-    list_node_init(&t->wait_node);
+    thread_init_kernel_context(t);
 
-    return true;
+    sched_entity_t *se = &g_sched[slot];
+    se->priority = g_current ? sched_entity(g_current)->priority : THREAD_PRIORITY_DEFAULT;
+    se->demotion = 0u;
+    se->slice_used = 0u;
+    se->rt = 0u;
+    se->cpu = (uint8_t)runqueue_select_cpu();
+    entity_update_level(se);
+    se->wake_tick = 0u;
+    se->wake_pending = 0u;
+#if SCHED_POLICY == SCHED_POLICY_FAIR
+    se->vruntime = g_rq[se->cpu].min_vruntime;
+#endif
+    t->runtime_us = 0u;
+    t->vfp = NULL;
+
+    return t;
+}
+
+/* Returns the handle of the new thread, or THREAD_HANDLE_INVALID. */
+uint32_t scheduler_thread_create(void(* func)(void *), const void * arg, unsigned int arg_size)
+{
+    return scheduler_thread_create_sized(func, arg, arg_size, STACK_SIZE);
+}
+
+/* stack_size is rounded up to the next kmem size class. */
+uint32_t scheduler_thread_create_sized(void (*func)(void *), const void *arg, unsigned int arg_size,
+                                       unsigned int stack_size)
+{
+    tcb_t *t = thread_setup(func, arg, arg_size, stack_size);
+    if (!t) {
+        return THREAD_HANDLE_INVALID;
+    }
+
+    runqueue_push(t);
+    return thread_handle(t);
+}
+
+uint32_t scheduler_rt_thread_create(void (*func)(void *), const void *arg, unsigned int arg_size,
+                                    uint32_t period_us, uint32_t budget_us, uint32_t deadline_us)
+{
+    if (deadline_us == 0u) {
+        deadline_us = period_us;
+    }
+
+    if (period_us == 0u || period_us > RT_MAX_PERIOD_US || budget_us == 0u ||
+        budget_us > deadline_us || deadline_us > period_us) {
+        kprintf("Invalid real-time parameters.\n");
+        return THREAD_HANDLE_INVALID;
+    }
+
+    uint32_t utilization = ((budget_us * RT_UTIL_SCALE) + deadline_us - 1u) / deadline_us;
+    if (g_rt_utilization + utilization > RT_UTIL_SCALE) {
+        kprintf("Real-time thread rejected, utilization exceeds 1.\n");
+        return THREAD_HANDLE_INVALID;
+    }
+
+    tcb_t *t = thread_setup(func, arg, arg_size, STACK_SIZE);
+    if (!t) {
+        return THREAD_HANDLE_INVALID;
+    }
+
+    sched_entity_t *se = sched_entity(t);
+    rt_entity_t *rt = rt_entity(se);
+    se->rt = 1u;
+    se->cpu = RT_CPU;
+    rt->period = period_us;
+    rt->budget = budget_us;
+    rt->deadline = deadline_us;
+    rt->utilization = utilization;
+    rt->deadline_misses = 0u;
+    rt_start_job(rt, systimer_now());
+    g_rt_utilization += utilization;
+
+    runqueue_push(t);
+    return thread_handle(t);
+}
+
+uint32_t scheduler_rt_wait_next_period(void)
+{
+    if (!g_current || is_idle_thread(g_current) || !sched_entity(g_current)->rt) {
+        return 0u;
+    }
+
+    sched_entity_t *se = sched_entity(g_current);
+    rt_entity_t *rt = rt_entity(se);
+    uint32_t now = systimer_now();
+    if (!deadline_reached(now, rt->abs_deadline)) {
+        rt->deadline_misses++;
+        g_stats.rt_deadline_misses++;
+    }
+
+    policy_account(g_current, now);
+    rt_defer(se, now);
+    return rt->deadline_misses;
+}
+
+/*
+ * Systimer channel RT_TIMER_CHANNEL fired: throttle the running RT thread if
+ * its budget is gone, then release every job that is due.
+ */
+void scheduler_rt_timer(void)
+{
+    uint32_t now = systimer_now();
+
+    if (g_current && !is_idle_thread(g_current)) {
+        sched_entity_t *se = sched_entity(g_current);
+        if (se->rt && se->state == T_RUNNING) {
+            rt_entity_t *rt = rt_entity(se);
+            policy_account(g_current, now);
+            if (rt->budget_left == 0u) {
+                rt->deadline_misses++;
+                g_stats.rt_deadline_misses++;
+                g_stats.rt_budget_overruns++;
+                rt_defer(se, now);
+            }
+        }
+    }
+
+    list_node *node;
+    while ((node = list_get_first(&g_release_queue)) != NULL) {
+        if (!deadline_reached(rt_key(node, false), now)) {
+            break;
+        }
+
+        list_remove_(node);
+        list_node_init(node);
+        rt_entity_t *rt = rt_entity(sched_entity_from_link(node));
+        rt_start_job(rt, rt->release);
+        runqueue_push(tcb_from_link(node));
+    }
+}
+
+static void rt_arm_timer(void)
+{
+    if (g_rt_utilization == 0u && !g_rt_timer_armed) {
+        return;
+    }
+
+    bool armed = false;
+    uint32_t event = 0u;
+    list_node *head = list_get_first(&g_release_queue);
+    if (head) {
+        event = rt_key(head, false);
+        armed = true;
+    }
+
+    if (g_current && sched_entity(g_current)->rt) {
+        uint32_t exhausted = g_current->dispatched_at + rt_entity(sched_entity(g_current))->budget_left;
+        if (!armed || deadline_reached(exhausted, event)) {
+            event = exhausted;
+        }
+        armed = true;
+    }
+
+    g_rt_timer_armed = armed;
+    if (!armed) {
+        irq_disable_systimer(RT_TIMER_CHANNEL);
+        return;
+    }
+
+    uint32_t earliest = systimer_now() + RT_MIN_EVENT_US;
+    if (deadline_reached(event, earliest)) {
+        event = earliest;
+    }
+    systimer_set_compare(RT_TIMER_CHANNEL, event);
+    systimer_clear_match(RT_TIMER_CHANNEL);
+    irq_enable_systimer(RT_TIMER_CHANNEL);
 }
 
 void scheduler_sleep_current(uint32_t ticks)
 {
-    if (!g_current || g_current == g_idle_tcb) {
+    if (!g_current || is_idle_thread(g_current)) {
         return;
     }
 
@@ -192,36 +1169,408 @@ void scheduler_sleep_current(uint32_t ticks)
         ticks = 1u;
     }
 
-    g_current->sleep_ticks = ticks;
-    g_current->state = T_SLEEPING;
+    sched_entity_t *se = sched_entity(g_current);
+    se->wake_tick = g_tick_count + ticks;
+    se->state = T_SLEEPING;
+    sleep_queue_insert(se);
+    policy_on_block(se);
+}
+
+/*
+ * Ends the current thread. Joiners wait on its joiners list and are woken
+ * here with the status written through the pointer they passed in r2.
+ */
+void scheduler_exit_current(int32_t status)
+{
+    if (!g_current || is_idle_thread(g_current)) {
+        return;
+    }
+
+    // Several 'S' in one RX burst must not free the thread twice
+    sched_entity_t *se = sched_entity(g_current);
+    if (se->state == T_UNUSED) {
+        return;
+    }
+    if (se->rt) {
+        g_rt_utilization -= rt_entity(se)->utilization;
+        se->rt = 0u;
+    }
+    se->state = T_UNUSED;
+#if SCHED_POLICY == SCHED_POLICY_MLFQ
+    if (se->demotion != 0u) {
+        list_remove_(&se->demoted_link);
+        se->demotion = 0u;
+    }
+#endif
+    vfp_release(g_current);
+    uring_thread_exit(g_current);
+
+    tcb_t *joiner;
+    while ((joiner = scheduler_wake_first(&g_current->joiners)) != NULL) {
+        if (joiner->ctx_storage.r2) {
+            *(int32_t *)joiner->ctx_storage.r2 = status;
+        }
+        joiner->ctx_storage.r0 = 0u;
+    }
+
+    // The blocks stay untouched until this thread has switched away, kmem
+    // and the switch both run under the kernel lock.
+    unsigned int slot = thread_index(g_current);
+    g_exit_status[slot] = status;
+    kmem_free(g_current->stack_base, (size_t)(g_current->stack_top - g_current->stack_base));
+    kmem_free(g_current, sizeof(tcb_t));
+    g_threads[slot] = NULL;
+    bitmap_set(&g_free_slots, slot);
+    poll_notify(POLL_THREAD_EXIT, 0u);
+}
+
+/* Whether handle names a user thread that exists or existed, not a stale slot. */
+static bool handle_valid(uint32_t handle)
+{
+    unsigned int slot = handle & (MAX_THREADS - 1u);
+    uint32_t generation = handle >> THREAD_SLOT_BITS;
+    return slot >= SMP_CORES && generation != 0u && generation == g_generation[slot];
+}
+
+join_result_t scheduler_join(uint32_t handle, int32_t *status)
+{
+    unsigned int slot = handle & (MAX_THREADS - 1u);
+    if (!g_current || is_idle_thread(g_current) || !handle_valid(handle)) {
+        return JOIN_INVALID;
+    }
+
+    tcb_t *target = g_threads[slot];
+    if (!target) {
+        *status = g_exit_status[slot];
+        return JOIN_EXITED;
+    }
+    if (target == g_current) {
+        return JOIN_INVALID;
+    }
+
+    scheduler_block_current(&target->joiners, T_JOINING);
+    return JOIN_BLOCKED;
+}
+
+/* Like scheduler_join without blocking, for poll. Returns false for an invalid handle. */
+bool scheduler_thread_exited(uint32_t handle, bool *exited)
+{
+    if (!handle_valid(handle)) {
+        return false;
+    }
+    *exited = g_threads[handle & (MAX_THREADS - 1u)] == NULL;
+    return true;
+}
+
+/*
+ * Wait queues of kernel objects. The current thread waits at the tail of
+ * wait_list, scheduler_wake_first() makes the longest waiter runnable again.
+ * Results for the waiter go into its ctx_storage before it runs, the kernel
+ * lock keeps it from running earlier.
+ */
+bool scheduler_block_current(list_node *wait_list, thread_state_t state)
+{
+    return scheduler_block_current_before(wait_list, NULL, state);
+}
+
+/* Blocks in front of waiter, or last for NULL, for wait lists kept in order. */
+bool scheduler_block_current_before(list_node *wait_list, tcb_t *waiter, thread_state_t state)
+{
+    if (!g_current || is_idle_thread(g_current)) {
+        return false;
+    }
+
+    sched_entity_t *se = sched_entity(g_current);
+    se->state = (uint8_t)state;
+    list_add_(&se->link, waiter ? sched_entity(waiter)->link.prev : wait_list->prev);
+    policy_on_block(se);
+    return true;
+}
+
+tcb_t *scheduler_wake_first(list_node *wait_list)
+{
+    list_node *node = list_remove_first(wait_list);
+    if (!node) {
+        return NULL;
+    }
+
+    list_node_init(node);
+    tcb_t *thread = tcb_from_link(node);
+    runqueue_push(thread);
+    return thread;
+}
+
+/* Longest waiter without waking it, for objects that serve waiters in parts. */
+tcb_t *scheduler_first_waiter(list_node *wait_list)
+{
+    list_node *node = list_get_first(wait_list);
+    return node ? tcb_from_link(node) : NULL;
+}
+
+/*
+ * Direct handoff for IPC: the waiter runs next on this core, without a trip
+ * through the run queue. The current thread blocks or is requeued as after a
+ * preemption. RT threads on either side take the normal wakeup path, the EDF
+ * order must not be bypassed.
+ */
+void scheduler_handoff(tcb_t *thread)
+{
+    unsigned int cpu = smp_cpu_id();
+    sched_entity_t *se = sched_entity(thread);
+    if (se->rt || g_handoff[cpu] || !g_current || is_idle_thread(g_current) ||
+        sched_entity(g_current)->rt) {
+        scheduler_wake_waiter(thread);
+        return;
+    }
+
+    list_remove_(&se->link);
+    list_node_init(&se->link);
+    se->cpu = (uint8_t)cpu;
+    policy_on_wake(&g_rq[cpu], se);
+    se->state = T_RUNNING;
+    se->woken_at = systimer_now();
+    se->wake_pending = 1u;
+    g_handoff[cpu] = thread;
+    g_need_resched |= 1u << cpu;
+}
+
+tcb_t *scheduler_next_waiter(list_node *wait_list, tcb_t *thread)
+{
+    list_node *node = sched_entity(thread)->link.next;
+    return node != wait_list ? tcb_from_link(node) : NULL;
+}
+
+/* Wakes a waiter picked by the caller, wherever it stands in its wait list. */
+void scheduler_wake_waiter(tcb_t *thread)
+{
+    list_node *node = &sched_entity(thread)->link;
+    list_remove_(node);
+    list_node_init(node);
+    runqueue_push(thread);
+}
+
+static uint32_t idle_elapsed_ticks(void)
+{
+    return (systimer_now() - g_idle_since) / TIMER_INTERVAL;
+}
+
+bool scheduler_set_priority(uint32_t priority)
+{
+    if (!g_current || is_idle_thread(g_current) || priority > THREAD_PRIORITY_MAX) {
+        return false;
+    }
+
+    sched_entity_t *se = sched_entity(g_current);
+    se->priority = (uint8_t)priority;
+    entity_update_level(se);
+    return true;
+}
+
+uint32_t scheduler_get_priority(void)
+{
+    if (!g_current || is_idle_thread(g_current)) {
+        return THREAD_PRIORITY_MIN;
+    }
+    return sched_entity(g_current)->priority;
 }
 
 void scheduler_tick(void)
 {
-    for (unsigned int i = 0; i < MAX_THREADS; ++i) {
-        tcb_t *thread = &g_threads[i];
-        if (thread == g_idle_tcb) {
-            continue;
+    uint32_t elapsed = 1u;
+    if (g_tick_stopped) {
+        elapsed = idle_elapsed_ticks();
+        if (elapsed == 0u) {
+            elapsed = 1u;
         }
+        g_tick_stopped = false;
+    }
 
-        if (thread->state == T_SLEEPING && thread->sleep_ticks > 0u) {
-            thread->sleep_ticks--;
-            if (thread->sleep_ticks == 0u) {
-                thread->state = T_RUNNING;
-            }
+    g_tick_count += elapsed;
+    time_page_update(g_tick_count);
+    g_stats.ticks++;
+#if SCHED_POLICY == SCHED_POLICY_MLFQ
+    if (g_tick_count - g_last_boost >= MLFQ_BOOST_TICKS) {
+        mlfq_boost();
+    }
+#endif
+    policy_on_tick();
+
+    list_node *node;
+    while ((node = list_get_first(&g_sleep_queue)) != NULL) {
+        g_stats.sleep_queue_visits++;
+        if (!deadline_reached(sched_entity_from_link(node)->wake_tick, g_tick_count)) {
+            break;
         }
+
+        list_remove_(node);
+        list_node_init(node);
+        runqueue_push(tcb_from_link(node));
     }
+
+    // Abgelaufene Leser kommen mit 0 Zeichen zurück, r0 steht schon
+    while ((node = list_get_first(&g_read_timers)) != NULL) {
+        sched_entity_t *se = sched_entity_from_timer_link(node);
+        if (!deadline_reached(se->wake_tick, g_tick_count)) {
+            break;
+        }
+
+        list_remove_(node);
+        list_node_init(node);
+        list_remove_(&se->link);
+        list_node_init(&se->link);
+        runqueue_push(tcb_from_link(&se->link));
+    }
+
+    for (unsigned int cpu = 0; cpu < SMP_CORES; ++cpu) {
+        if (!(g_idle_cpus & (1u << cpu))) {
+            smp_send_ipi(cpu, SMP_IPI_TICK);
+        }
+    }
+}
+
+/* The tick as seen by the other cores, forwarded by scheduler_tick(). */
+void scheduler_ipi_tick(void)
+{
+    policy_on_tick();
+}
+
+bool scheduler_tick_stopped(void)
+{
+    return g_tick_stopped;
+}
+
+bool scheduler_need_resched(void)
+{
+    return (g_need_resched & (1u << smp_cpu_id())) != 0u;
+}
+
+#if SCHED_TICKLESS
+/* Earliest deadline of the sleep queue, the timed readers, uring requests and pollers. */
+static bool earliest_timeout(uint32_t *wake_tick)
+{
+    bool found = uring_next_deadline(wake_tick);
+    uint32_t poll_tick;
+    if (poll_next_deadline(&poll_tick) && (!found || deadline_reached(poll_tick, *wake_tick))) {
+        *wake_tick = poll_tick;
+        found = true;
+    }
+    list_node *head = list_get_first(&g_sleep_queue);
+    if (head && (!found || deadline_reached(sched_entity_from_link(head)->wake_tick, *wake_tick))) {
+        *wake_tick = sched_entity_from_link(head)->wake_tick;
+        found = true;
+    }
+    head = list_get_first(&g_read_timers);
+    if (head && (!found || deadline_reached(sched_entity_from_timer_link(head)->wake_tick, *wake_tick))) {
+        *wake_tick = sched_entity_from_timer_link(head)->wake_tick;
+        found = true;
+    }
+    return found;
+}
+#endif
+
+/*
+ * Called after every scheduling decision. Normal threads get a fresh time
+ * slice. With SCHED_TICKLESS the tick stops once every core idles and the
+ * timer is programmed for the earliest sleeper instead, or until an
+ * interrupt makes a thread runnable. Ticks missed meanwhile are accounted
+ * when the tick resumes, so sleep deadlines stay in tick units.
+ *
+ * Core 0 receives the tick and forwards it to the other busy cores. While
+ * they run threads the tick stays periodic, a dispatch on core 0 only
+ * restarts it when no other core depends on it.
+ */
+void scheduler_arm_timer(void)
+{
+    unsigned int cpu = smp_cpu_id();
+    if (cpu == RT_CPU) {
+        rt_arm_timer();
+    }
+
+    bool restart = cpu == 0u && (g_idle_cpus | 1u) == ALL_CPUS;
+#if SCHED_TICKLESS
+    if (g_idle_cpus == ALL_CPUS) {
+        if (!g_tick_stopped) {
+            g_tick_stopped = true;
+            g_idle_since = systimer_now();
+            g_stats.tick_stops++;
+        }
+
+        uint32_t wake_tick;
+        if (!earliest_timeout(&wake_tick)) {
+            irq_disable_systimer(1);
+            return;
+        }
+
+        uint32_t ticks = wake_tick - g_tick_count;
+        if ((int32_t)ticks <= 0) {
+            ticks = 1u;
+        }
+        systimer_set_compare(1, g_idle_since + ticks * TIMER_INTERVAL);
+        systimer_clear_match(1);
+        irq_enable_systimer(1);
+        return;
+    }
+
+    if (g_tick_stopped) {
+        g_tick_count += idle_elapsed_ticks();
+        time_page_update(g_tick_count);
+        g_tick_stopped = false;
+        systimer_clear_match(1);
+        irq_enable_systimer(1);
+        restart = true;
+    }
+#endif
+    uint32_t now = systimer_now();
+    if (restart || deadline_reached(g_tick_deadline, now)) {
+        g_tick_deadline = now + TIMER_INTERVAL;
+        systimer_set_compare(1, g_tick_deadline);
+    }
+}
+
+uint32_t scheduler_ticks(void)
+{
+    return g_tick_count;
+}
+
+void scheduler_record_irq_latency(uint32_t latency_us)
+{
+    if (latency_us > g_stats.irq_latency_max_us) {
+        g_stats.irq_latency_max_us = latency_us;
+    }
+}
+
+void scheduler_record_svc_cycles(uint32_t cycles)
+{
+    g_stats.svc_cycles_last = cycles;
+    if (cycles > g_stats.svc_cycles_max) {
+        g_stats.svc_cycles_max = cycles;
+    }
+}
+
+/* PMU cycles at the IRQ entry of a tick, the next reschedule on this core measures from there. */
+void scheduler_record_tick_entry(uint32_t entry_cycles)
+{
+    unsigned int cpu = smp_cpu_id();
+    g_tick_entry_cycles[cpu] = entry_cycles;
+    g_tick_entry_valid[cpu] = true;
+}
+
+const scheduler_stats_t *scheduler_get_stats(void)
+{
+    return &g_stats;
 }
 
 bool scheduler_block_current_on_input(void)
 {
-    if (!g_current || g_current == g_idle_tcb) {
+    if (!g_current || is_idle_thread(g_current)) {
         return false;
     }
 
-    if (g_current->state != T_WAITING_IO) {
-        g_current->state = T_WAITING_IO;
-        list_add_last(&g_getc_wait_list_head, &g_current->wait_node);
+    sched_entity_t *se = sched_entity(g_current);
+    if (se->state != T_WAITING_IO) {
+        se->state = T_WAITING_IO;
+        list_add_last(&g_getc_wait_list_head, &se->link);
+        policy_on_block(se);
     }
 
     return true;
@@ -239,17 +1588,72 @@ tcb_t *scheduler_pop_next_input_waiter(void)
         return NULL;
     }
 
-    tcb_t *thread = tcb_from_wait_node(node);
     list_node_init(node);
-    thread->sleep_ticks = 0u;
-    thread->state = T_RUNNING;
+    sched_entity_t *se = sched_entity_from_link(node);
+    se->woken_at = systimer_now();
+    se->wake_pending = 1u;
+
+    tcb_t *thread = tcb_from_link(node);
+    runqueue_push(thread);
+    return thread;
+}
+
+/*
+ * Readers wait FIFO until input arrives or, for ticks != 0, until their
+ * timeout runs out. The UART interrupt hands the first reader everything
+ * buffered at once, see scheduler_pop_next_reader().
+ */
+bool scheduler_block_current_on_read(uint32_t ticks)
+{
+    if (!g_current || is_idle_thread(g_current)) {
+        return false;
+    }
+
+    sched_entity_t *se = sched_entity(g_current);
+    se->state = ticks != 0u ? T_SLEEPING : T_WAITING_IO;
+    se->wake_tick = g_tick_count + ticks;
+    list_add_last(&g_read_wait_list, &se->link);
+    list_node_init(&se->timer_link);
+    if (ticks != 0u) {
+        read_timer_insert(se);
+    }
+    policy_on_block(se);
+    return true;
+}
+
+bool scheduler_has_waiting_reader(void)
+{
+    return !list_is_empty(&g_read_wait_list);
+}
+
+tcb_t *scheduler_pop_next_reader(void)
+{
+    list_node *node = list_remove_first(&g_read_wait_list);
+    if (!node) {
+        return NULL;
+    }
+
+    list_node_init(node);
+    sched_entity_t *se = sched_entity_from_link(node);
+    list_remove_(&se->timer_link);
+    list_node_init(&se->timer_link);
+    se->woken_at = systimer_now();
+    se->wake_pending = 1u;
+
+    tcb_t *thread = tcb_from_link(node);
+    runqueue_push(thread);
     return thread;
 }
 
+/*
+ * Entered once by every core, with its mode stacks set up. The boot stack is
+ * left behind for good, the first thread releases the kernel lock.
+ */
 __attribute__((noreturn)) void scheduler_start(void) 
 {
+    smp_kernel_lock();
     scheduler_pick_next();
-    systimer_increment_compare(1, TIMER_INTERVAL);
-    scheduler_first_context_restore(&g_current->ctx_storage);
+    scheduler_arm_timer();
+    cpu_switch_to(&g_boot_kctx[smp_cpu_id()], &g_current->kctx);
     __builtin_unreachable();
 }
\ No newline at end of file
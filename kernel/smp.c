@@ -0,0 +1,87 @@
+#include <kernel/smp.h>
+#include <kernel/scheduler.h>
+#include <kernel/vfp.h>
+#include <kernel/pmu.h>
+
+#include <arch/bsp/local_irq.h>
+
+#include <lib/spinlock.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * One lock serializes all kernel entries of all cores. Kernel paths are short
+ * compared to the user code in between, so the cores still run their threads
+ * in parallel.
+ */
+#if SMP_CORES > 1
+static spinlock_t g_kernel_lock = SPINLOCK_INIT;
+#endif
+static volatile bool g_secondaries_released = false;
+
+// Mailbox 3 weckt die Kerne 1-3 auf der Hardware aus der Firmware-Warteschleife
+#define SMP_BOOT_MAILBOX 3u
+#define SMP_IPI_MAILBOX	 0u
+
+extern void _start(void);
+
+void smp_init(void)
+{
+	local_irq_enable_mailbox(smp_cpu_id());
+}
+
+void smp_start_secondaries(void)
+{
+	g_secondaries_released = true;
+	__asm__ volatile("dsb\n"
+			 "sev" ::: "memory");
+
+	for (unsigned int cpu = 1; cpu < SMP_CORES; ++cpu) {
+		local_irq_mailbox_write(cpu, SMP_BOOT_MAILBOX, (unsigned int)_start);
+	}
+}
+
+/* Entry of cores 1-3 from kernel.S once their mode stacks are set up. */
+__attribute__((noreturn)) void smp_secondary_main(void)
+{
+	while (!g_secondaries_released) {
+		__asm__ volatile("wfe");
+	}
+
+	smp_init();
+	vfp_init();
+	pmu_init();
+	scheduler_start();
+}
+
+void smp_send_ipi(unsigned int cpu, uint32_t msg)
+{
+	if (cpu == smp_cpu_id() || cpu >= SMP_CORES) {
+		return;
+	}
+	local_irq_mailbox_write(cpu, SMP_IPI_MAILBOX, msg);
+}
+
+uint32_t smp_take_ipi(void)
+{
+#if SMP_CORES > 1
+	return local_irq_mailbox_take(smp_cpu_id(), SMP_IPI_MAILBOX);
+#else
+	return 0u;
+#endif
+}
+
+void smp_kernel_lock(void)
+{
+#if SMP_CORES > 1
+	spin_lock(&g_kernel_lock);
+#endif
+}
+
+void smp_kernel_unlock(void)
+{
+#if SMP_CORES > 1
+	spin_unlock(&g_kernel_lock);
+#endif
+}
@@ -2,7 +2,17 @@
 #include <arch/bsp/systimer.h>
 #include <arch/bsp/irq.h>
 
+#include <kernel/futex.h>
+#include <kernel/ipc.h>
+#include <kernel/poll.h>
 #include <kernel/scheduler.h>
+#include <kernel/smp.h>
+#include <kernel/hrtimer.h>
+#include <kernel/timepage.h>
+#include <kernel/uring.h>
+#include <kernel/vfp.h>
+#include <kernel/pmu.h>
+#include <kernel/workq.h>
 
 #include <lib/kprintf.h>
 
@@ -16,12 +26,23 @@ __attribute__((noreturn)) void start_kernel (void)
 	uart_enable_rx_interrupt();
 	irq_enable_uart();
 	irq_enable_systimer(1);
+	smp_init();
+	vfp_init();
+	pmu_init();
 
 	scheduler_init(); 
+	workq_init();
+	uring_init();
+	futex_init();
+	ipc_init();
+	poll_init();
+	time_page_init();
+	hrtimer_init();
 
 	kprintf("=== Betriebssystem gestartet ===\n");
 	test_kernel();
 	
+	smp_start_secondaries();
 	scheduler_start();
 
 	__builtin_unreachable();
@@ -1,14 +1,26 @@
 #include <kernel/syscall_dispatch.h>
 
 #include <arch/bsp/uart.h>
+#include <kernel/futex.h>
+#include <kernel/hrtimer.h>
+#include <kernel/ipc.h>
+#include <kernel/poll.h>
 #include <kernel/scheduler.h>
+#include <kernel/timepage.h>
+#include <kernel/uring.h>
+#include <kernel/workq.h>
 #include <syscall.h>
 
 #include <config.h>
 
+#include <lib/list.h>
+
 #include <stdbool.h>
 #include <stddef.h>
 
+// Blockierte Writer, nur der erste wird weiter ausgegeben
+static list_node g_write_waiters = { &g_write_waiters, &g_write_waiters };
+
 static syscall_result_t make_result(uint32_t value, bool reschedule, bool advance_pc)
 {
 	syscall_result_t result = {
@@ -31,21 +43,234 @@ static syscall_result_t make_unhandled(void)
 	return result;
 }
 
-static syscall_result_t handle_exit(void)
+static syscall_result_t handle_exit(const context_frame_t *ctx)
 {
-	if (g_current) {
-		g_current->state = T_UNUSED;
-	}
+	scheduler_exit_current((int32_t)ctx->r1);
 	return make_result(0u, true, false);
 }
 
+/*
+ * syscall_putc und syscall_write teilen sich den Ausgabepuffer und
+ * g_write_waiters, damit die Ausgabe in Reihenfolge bleibt. Bei einem Writer
+ * zählt r0 die schon ausgegebenen Zeichen, ein wartendes putc hat stattdessen
+ * PUTC_PENDING in r0. r1 und r2 bleiben unverändert, die gehören laut
+ * syscall_invoke weiter dem User.
+ */
+#define PUTC_PENDING 0xFFFFFFFFu
+
 static syscall_result_t handle_putc(const context_frame_t *ctx)
 {
 	char c = (char)(ctx->r1 & 0xFFu);
-	uart_putc(c);
+	if (list_is_empty(&g_write_waiters) && uart_write_nonblocking(&c, 1u) == 1u) {
+		return make_result(0u, false, true);
+	}
+
+	if (!scheduler_block_current(&g_write_waiters, T_WAITING_IO)) {
+		return make_unhandled();
+	}
+	return make_result(PUTC_PENDING, true, true);
+}
+
+static syscall_result_t handle_write(const context_frame_t *ctx)
+{
+	const char *buf = (const char *)ctx->r1;
+	size_t	    len = ctx->r2;
+	if (len == 0u) {
+		return make_result(0u, false, true);
+	}
+	if (!user_buffer_valid(ctx->r1, ctx->r2)) {
+		return make_result((uint32_t)-1, false, true);
+	}
+
+	size_t done = list_is_empty(&g_write_waiters) ? uart_write_nonblocking(buf, len) : 0u;
+	if (done == len) {
+		return make_result(len, false, true);
+	}
+
+	if (!scheduler_block_current(&g_write_waiters, T_WAITING_IO)) {
+		return make_unhandled();
+	}
+	return make_result(done, true, true);
+}
+
+// Vom UART TX Interrupt, sobald wieder Platz im Ausgabepuffer ist
+void syscall_output_ready(void)
+{
+	tcb_t *writer;
+	while ((writer = scheduler_first_waiter(&g_write_waiters)) != NULL) {
+		context_frame_t *ctx = &writer->ctx_storage;
+		if (ctx->r0 == PUTC_PENDING) {
+			char c = (char)(ctx->r1 & 0xFFu);
+			if (uart_write_nonblocking(&c, 1u) != 1u) {
+				break;
+			}
+			ctx->r0 = 0u;
+		} else {
+			ctx->r0 += uart_write_nonblocking((const char *)(ctx->r1 + ctx->r0), ctx->r2 - ctx->r0);
+			if (ctx->r0 != ctx->r2) {
+				break;
+			}
+		}
+		(void)scheduler_wake_first(&g_write_waiters);
+	}
+}
+
+// Ob niemand auf Platz im Ausgabepuffer wartet, uring Ausgaben stellen sich sonst hinten an
+bool syscall_output_idle(void)
+{
+	return list_is_empty(&g_write_waiters);
+}
+
+// Ein blockierter Leser bekommt r0 vom UART Interrupt oder bleibt beim Timeout bei 0
+static syscall_result_t handle_read(const context_frame_t *ctx)
+{
+	char	*buf	 = (char *)ctx->r1;
+	size_t	 maxlen	 = ctx->r2;
+	uint32_t timeout = ctx->r3;
+	if (maxlen == 0u) {
+		return make_result(0u, false, true);
+	}
+	if (!user_buffer_valid(ctx->r1, ctx->r2)) {
+		return make_result((uint32_t)-1, false, true);
+	}
+
+	size_t done = uart_read_nonblocking(buf, maxlen);
+	if (done != 0u || timeout == 0u) {
+		return make_result(done, false, true);
+	}
+
+	if (!scheduler_block_current_on_read(timeout == READ_TIMEOUT_INFINITE ? 0u : timeout)) {
+		return make_unhandled();
+	}
+	return make_result(0u, true, true);
+}
+
+static syscall_result_t handle_rx_ring(void)
+{
+	return make_result((uint32_t)uart_rx_ring(), false, true);
+}
+
+/* A reader without buffer, it is woken with r0 = 1 and the input stays in the ring. */
+static syscall_result_t handle_rx_wait(const context_frame_t *ctx)
+{
+	char available;
+	if (uart_peekc(&available)) {
+		return make_result(1u, false, true);
+	}
+	if (ctx->r3 == 0u) {
+		return make_result(0u, false, true);
+	}
+
+	if (!scheduler_block_current_on_read(ctx->r3 == READ_TIMEOUT_INFINITE ? 0u : ctx->r3)) {
+		return make_unhandled();
+	}
+	return make_result(0u, true, true);
+}
+
+static syscall_result_t handle_uring_setup(const context_frame_t *ctx)
+{
+	return make_result(uring_setup((struct uring *)ctx->r1), false, true);
+}
+
+// Ein blockierter Aufrufer behält in r0 die Zahl der übernommenen Aufträge
+static syscall_result_t handle_uring_enter(const context_frame_t *ctx)
+{
+	uint32_t submitted = 0u;
+	switch (uring_enter(ctx->r1, ctx->r2, &submitted)) {
+	case URING_DONE:
+		return make_result(submitted, false, true);
+	case URING_BLOCKED:
+		return make_result(submitted, true, true);
+	case URING_INVALID:
+	default:
+		return make_result((uint32_t)-1, false, true);
+	}
+}
+
+static syscall_result_t handle_uring_release(const context_frame_t *ctx)
+{
+	uring_release(ctx->r1);
 	return make_result(0u, false, true);
 }
 
+// Ein geweckter Waiter behält r0 = 0
+static syscall_result_t handle_futex_wait(const context_frame_t *ctx)
+{
+	switch (futex_wait(ctx->r1, ctx->r2)) {
+	case FUTEX_BLOCKED:
+		return make_result(0u, true, true);
+	case FUTEX_AGAIN:
+		return make_result(1u, false, true);
+	case FUTEX_INVALID:
+	default:
+		return make_result((uint32_t)-1, false, true);
+	}
+}
+
+static syscall_result_t handle_futex_wake(const context_frame_t *ctx)
+{
+	return make_result(futex_wake(ctx->r1, ctx->r2), false, true);
+}
+
+static syscall_result_t handle_futex_cmpxchg(const context_frame_t *ctx)
+{
+	uint32_t prev = 0u;
+	if (!futex_cmpxchg(ctx->r1, ctx->r2, ctx->r3, &prev)) {
+		scheduler_exit_current(THREAD_EXIT_KILLED);
+		return make_result(0u, true, false);
+	}
+	return make_result(prev, false, true);
+}
+
+static syscall_result_t handle_port_create(void)
+{
+	return make_result(ipc_port_create(), false, true);
+}
+
+/* Blocked senders and receivers get r0 from the thread that unblocks them. */
+static syscall_result_t make_ipc_result(ipc_result_t result)
+{
+	switch (result) {
+	case IPC_DONE:
+		return make_result(0u, false, true);
+	case IPC_BLOCKED:
+		return make_result(0u, true, true);
+	case IPC_INVALID:
+	default:
+		return make_result(1u, false, true);
+	}
+}
+
+static syscall_result_t handle_port_send(const context_frame_t *ctx)
+{
+	return make_ipc_result(ipc_send(ctx->r1, (const struct ipc_msg *)ctx->r2));
+}
+
+static syscall_result_t handle_port_receive(const context_frame_t *ctx)
+{
+	return make_ipc_result(ipc_receive(ctx->r1, (struct ipc_msg *)ctx->r2));
+}
+
+// Ein blockierter Poller bekommt r0 und die ready Flags von poll_notify/poll_tick
+static syscall_result_t handle_poll(const context_frame_t *ctx)
+{
+	uint32_t ready = 0u;
+	switch (poll_wait((struct poll_event *)ctx->r1, ctx->r2, &ready)) {
+	case POLL_DONE:
+		return make_result(ready, false, true);
+	case POLL_BLOCKED:
+		return make_result(0u, true, true);
+	case POLL_INVALID:
+	default:
+		return make_result((uint32_t)-1, false, true);
+	}
+}
+
+static syscall_result_t handle_time_page(void)
+{
+	return make_result((uint32_t)time_page_get(), false, true);
+}
+
 static syscall_result_t handle_getc(void)
 {
 	char c;
@@ -65,8 +290,76 @@ static syscall_result_t handle_create_thread(const context_frame_t *ctx)
 	void (*func)(void *) = (void (*)(void *))ctx->r1;
 	void *arg = (void *)ctx->r2;
 	unsigned int arg_size = (unsigned int)ctx->r3;
-	bool created = scheduler_thread_create(func, arg, arg_size);
-	return make_result(created ? 0u : 1u, false, true);
+	uint32_t handle = scheduler_thread_create(func, arg, arg_size);
+	return make_result(handle, false, true);
+}
+
+static syscall_result_t handle_create_thread_sized(const context_frame_t *ctx)
+{
+	const struct thread_params *params = (const struct thread_params *)ctx->r1;
+	if ((ctx->r1 & 3u) != 0u || !user_buffer_valid(ctx->r1, sizeof(*params))) {
+		return make_result(THREAD_HANDLE_INVALID, false, true);
+	}
+
+	uint32_t handle = scheduler_thread_create_sized(params->func, params->args, params->arg_size,
+							params->stack_size);
+	return make_result(handle, false, true);
+}
+
+/* A blocked joiner gets r0 and its status from scheduler_exit_current(). */
+static syscall_result_t handle_join(const context_frame_t *ctx)
+{
+	// Der Status wird eventuell erst beim Exit eines anderen Threads geschrieben
+	if (ctx->r2 && ((ctx->r2 & 3u) != 0u || !user_buffer_valid(ctx->r2, sizeof(int32_t)))) {
+		return make_result(1u, false, true);
+	}
+
+	int32_t status = 0;
+	switch (scheduler_join(ctx->r1, &status)) {
+	case JOIN_EXITED:
+		if (ctx->r2) {
+			*(int32_t *)ctx->r2 = status;
+		}
+		return make_result(0u, false, true);
+	case JOIN_BLOCKED:
+		return make_result(0u, true, true);
+	case JOIN_INVALID:
+	default:
+		return make_result(1u, false, true);
+	}
+}
+
+static syscall_result_t handle_workq_create(void)
+{
+	return make_result(workq_create(), false, true);
+}
+
+/* Blocked submitters and workers get r0 from the thread that unblocks them. */
+static syscall_result_t make_workq_result(workq_result_t result)
+{
+	switch (result) {
+	case WORKQ_DONE:
+		return make_result(0u, false, true);
+	case WORKQ_BLOCKED:
+		return make_result(0u, true, true);
+	case WORKQ_INVALID:
+	default:
+		return make_result(1u, false, true);
+	}
+}
+
+static syscall_result_t handle_workq_submit(const context_frame_t *ctx)
+{
+	struct work_item item = {
+		.func = (void (*)(void *))ctx->r2,
+		.arg  = (void *)ctx->r3,
+	};
+	return make_workq_result(workq_submit(ctx->r1, &item));
+}
+
+static syscall_result_t handle_workq_wait(const context_frame_t *ctx)
+{
+	return make_workq_result(workq_wait(ctx->r1, (struct work_item *)ctx->r2));
 }
 
 static syscall_result_t handle_sleep(const context_frame_t *ctx)
@@ -76,6 +369,44 @@ static syscall_result_t handle_sleep(const context_frame_t *ctx)
 	return make_result(0u, true, true);
 }
 
+static syscall_result_t handle_sleep_until(const context_frame_t *ctx)
+{
+	uint64_t deadline = ((uint64_t)ctx->r2 << 32) | ctx->r1;
+	bool	 blocked  = hrtimer_sleep_until(deadline) == HRTIMER_BLOCKED;
+	return make_result(0u, blocked, true);
+}
+
+static syscall_result_t handle_set_priority(const context_frame_t *ctx)
+{
+	uint32_t old_priority = scheduler_get_priority();
+	bool changed = scheduler_set_priority(ctx->r1);
+	bool lowered = changed && ctx->r1 < old_priority;
+	return make_result(changed ? 0u : 1u, lowered, true);
+}
+
+static syscall_result_t handle_get_priority(void)
+{
+	return make_result(scheduler_get_priority(), false, true);
+}
+
+static syscall_result_t handle_create_rt_thread(const context_frame_t *ctx)
+{
+	const struct rt_thread_params *params = (const struct rt_thread_params *)ctx->r1;
+	if ((ctx->r1 & 3u) != 0u || !user_buffer_valid(ctx->r1, sizeof(*params))) {
+		return make_result(THREAD_HANDLE_INVALID, false, true);
+	}
+
+	uint32_t handle = scheduler_rt_thread_create(params->func, params->args, params->arg_size,
+						     params->period_us, params->budget_us,
+						     params->deadline_us);
+	return make_result(handle, handle != THREAD_HANDLE_INVALID, true);
+}
+
+static syscall_result_t handle_rt_wait_next_period(void)
+{
+	return make_result(scheduler_rt_wait_next_period(), true, true);
+}
+
 syscall_result_t syscall_dispatch(context_frame_t *ctx)
 {
 	if (!ctx) {
@@ -84,7 +415,7 @@ syscall_result_t syscall_dispatch(context_frame_t *ctx)
 
 	switch ((syscall_id_t)ctx->r0) {
 	case SYSCALL_ID_EXIT:
-		return handle_exit();
+		return handle_exit(ctx);
 	case SYSCALL_ID_PUTC:
 		return handle_putc(ctx);
 	case SYSCALL_ID_GETC:
@@ -93,6 +424,56 @@ syscall_result_t syscall_dispatch(context_frame_t *ctx)
 		return handle_create_thread(ctx);
 	case SYSCALL_ID_SLEEP:
 		return handle_sleep(ctx);
+	case SYSCALL_ID_SET_PRIORITY:
+		return handle_set_priority(ctx);
+	case SYSCALL_ID_GET_PRIORITY:
+		return handle_get_priority();
+	case SYSCALL_ID_CREATE_RT_THREAD:
+		return handle_create_rt_thread(ctx);
+	case SYSCALL_ID_RT_WAIT_NEXT_PERIOD:
+		return handle_rt_wait_next_period();
+	case SYSCALL_ID_CREATE_THREAD_SIZED:
+		return handle_create_thread_sized(ctx);
+	case SYSCALL_ID_JOIN:
+		return handle_join(ctx);
+	case SYSCALL_ID_WORKQ_CREATE:
+		return handle_workq_create();
+	case SYSCALL_ID_WORKQ_SUBMIT:
+		return handle_workq_submit(ctx);
+	case SYSCALL_ID_WORKQ_WAIT:
+		return handle_workq_wait(ctx);
+	case SYSCALL_ID_WRITE:
+		return handle_write(ctx);
+	case SYSCALL_ID_READ:
+		return handle_read(ctx);
+	case SYSCALL_ID_RX_RING:
+		return handle_rx_ring();
+	case SYSCALL_ID_RX_WAIT:
+		return handle_rx_wait(ctx);
+	case SYSCALL_ID_URING_SETUP:
+		return handle_uring_setup(ctx);
+	case SYSCALL_ID_URING_ENTER:
+		return handle_uring_enter(ctx);
+	case SYSCALL_ID_URING_RELEASE:
+		return handle_uring_release(ctx);
+	case SYSCALL_ID_FUTEX_WAIT:
+		return handle_futex_wait(ctx);
+	case SYSCALL_ID_FUTEX_WAKE:
+		return handle_futex_wake(ctx);
+	case SYSCALL_ID_FUTEX_CMPXCHG:
+		return handle_futex_cmpxchg(ctx);
+	case SYSCALL_ID_PORT_CREATE:
+		return handle_port_create();
+	case SYSCALL_ID_PORT_SEND:
+		return handle_port_send(ctx);
+	case SYSCALL_ID_PORT_RECEIVE:
+		return handle_port_receive(ctx);
+	case SYSCALL_ID_POLL:
+		return handle_poll(ctx);
+	case SYSCALL_ID_TIME_PAGE:
+		return handle_time_page();
+	case SYSCALL_ID_SLEEP_UNTIL:
+		return handle_sleep_until(ctx);
 	case SYSCALL_ID_UNDEFINED:
 	default:
 		return make_unhandled();
@@ -0,0 +1,45 @@
+#include <kernel/timepage.h>
+
+#include <arch/bsp/systimer.h>
+
+#include <config.h>
+
+#include <stdint.h>
+
+/*
+ * Eigene Seite, damit sie sich später read-only einblenden lässt. Ohne MMU
+ * ist "nur lesen" für User Threads eine Abmachung.
+ */
+static struct time_page g_time_page __attribute__((aligned(4096)));
+
+void time_page_init(void)
+{
+	g_time_page.seq		   = 0u;
+	g_time_page.ticks	   = 0u;
+	g_time_page.timer_interval = TIMER_INTERVAL;
+	g_time_page.clo		   = &systimer->clo;
+	g_time_page.chi		   = &systimer->chi;
+	time_page_update(0u);
+}
+
+/*
+ * Seqlock Schreibseite: ungerade seq heißt Update läuft. Nur unter dem
+ * Kernel Lock aufgerufen, es gibt also nie zwei Schreiber.
+ */
+void time_page_update(uint32_t ticks)
+{
+	uint64_t now = systimer_now64();
+
+	g_time_page.seq++;
+	__asm__ volatile("dmb" ::: "memory");
+	g_time_page.ticks	 = ticks;
+	g_time_page.tick_time_lo = (uint32_t)now;
+	g_time_page.tick_time_hi = (uint32_t)(now >> 32);
+	__asm__ volatile("dmb" ::: "memory");
+	g_time_page.seq++;
+}
+
+struct time_page *time_page_get(void)
+{
+	return &g_time_page;
+}
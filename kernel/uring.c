@@ -0,0 +1,320 @@
+#include <kernel/uring.h>
+#include <kernel/scheduler.h>
+#include <kernel/syscall_dispatch.h>
+
+#include <arch/bsp/uart.h>
+
+#include <lib/list.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Requests are copied out of the submission ring when they are taken, so the
+ * user may reuse the entry right away. Each one then sits in ops[] until
+ * op_progress() completes it without blocking and a completion entry is
+ * free. Threads in syscall_uring_enter wait on waiters with min_complete in
+ * their r2.
+ */
+typedef struct uring_req {
+	struct uring_sqe sqe;
+	uint32_t	 done;
+	uint32_t	 deadline;
+	int32_t		 result;
+	bool		 timed;
+	bool		 complete;
+	bool		 used;
+} uring_req_t;
+
+typedef struct uring_ctx {
+	struct uring *ring;
+	const tcb_t  *owner;
+	uring_req_t   ops[URING_ENTRIES];
+	unsigned int  inflight;
+	list_node     waiters;
+} uring_ctx_t;
+
+static uring_ctx_t g_uring[URING_MAX];
+
+/* Returns the ring if it is registered and belongs to the calling thread. */
+static uring_ctx_t *uring_get(uint32_t id)
+{
+	if (id == 0u || id > URING_MAX || !g_uring[id - 1u].ring || g_uring[id - 1u].owner != g_current) {
+		return NULL;
+	}
+	return &g_uring[id - 1u];
+}
+
+static void uring_ctx_release(uring_ctx_t *ctx)
+{
+	ctx->ring  = NULL;
+	ctx->owner = NULL;
+	while (scheduler_wake_first(&ctx->waiters) != NULL) {
+	}
+}
+
+static bool deadline_passed(uint32_t deadline)
+{
+	return (int32_t)(scheduler_ticks() - deadline) >= 0;
+}
+
+static void op_complete(uring_req_t *op, int32_t result)
+{
+	op->result   = result;
+	op->complete = true;
+}
+
+static void op_start(uring_req_t *op, const struct uring_sqe *sqe)
+{
+	op->sqe	     = *sqe;
+	op->done     = 0u;
+	op->timed    = false;
+	op->complete = false;
+	op->used     = true;
+
+	switch (sqe->op) {
+	case URING_OP_READ:
+		// Timeouts wie bei syscall_read, 0 fragt nur einmal nach
+		if (sqe->arg3 != READ_TIMEOUT_INFINITE) {
+			op->timed    = true;
+			op->deadline = scheduler_ticks() + sqe->arg3;
+		}
+		[[fallthrough]];
+	case URING_OP_WRITE:
+		if (sqe->arg2 != 0u && !user_buffer_valid(sqe->arg1, sqe->arg2)) {
+			op_complete(op, -1);
+		}
+		break;
+	case URING_OP_SLEEP:
+		op->timed    = true;
+		op->deadline = scheduler_ticks() + (sqe->arg1 != 0u ? sqe->arg1 : 1u);
+		break;
+	case URING_OP_PUTC:
+	case URING_OP_CREATE:
+		break;
+	default:
+		op_complete(op, -1);
+		break;
+	}
+}
+
+static void op_progress(uring_req_t *op, bool from_enter)
+{
+	const struct uring_sqe *sqe = &op->sqe;
+	switch (sqe->op) {
+	case URING_OP_PUTC: {
+		char c = (char)sqe->arg1;
+		if (syscall_output_idle() && uart_write_nonblocking(&c, 1u) == 1u) {
+			op_complete(op, 0);
+		}
+		break;
+	}
+	case URING_OP_WRITE:
+		// Blockierte syscall_write/putc kommen zuerst dran, siehe syscall_output_ready
+		if (!syscall_output_idle()) {
+			break;
+		}
+		op->done += uart_write_nonblocking((const char *)(sqe->arg1 + op->done), sqe->arg2 - op->done);
+		if (op->done == sqe->arg2) {
+			op_complete(op, (int32_t)sqe->arg2);
+		}
+		break;
+	case URING_OP_READ: {
+		size_t n = sqe->arg2 != 0u ? uart_read_nonblocking((char *)sqe->arg1, sqe->arg2) : 0u;
+		if (n != 0u || sqe->arg2 == 0u || (op->timed && deadline_passed(op->deadline))) {
+			op_complete(op, (int32_t)n);
+		}
+		break;
+	}
+	case URING_OP_SLEEP:
+		if (deadline_passed(op->deadline)) {
+			op_complete(op, 0);
+		}
+		break;
+	case URING_OP_CREATE:
+		// Der neue Thread erbt die Priorität von g_current, im Interrupt wäre das irgendwer
+		if (from_enter) {
+			void (*func)(void *) = (void (*)(void *))sqe->arg1;
+			op_complete(op, (int32_t)scheduler_thread_create(func, (void *)sqe->arg2, sqe->arg3));
+		}
+		break;
+	}
+}
+
+static uint32_t cq_ready(const struct uring *ring)
+{
+	return ring->cq_tail - ring->cq_head;
+}
+
+static uint32_t uring_take(uring_ctx_t *ctx)
+{
+	struct uring *ring  = ctx->ring;
+	uint32_t      head  = ring->sq_head;
+	uint32_t      tail  = ring->sq_tail;
+	uint32_t      taken = 0u;
+	__asm__ volatile("dmb" ::: "memory");
+
+	unsigned int slot = 0;
+	while (head != tail && ctx->inflight < URING_ENTRIES) {
+		while (ctx->ops[slot].used) {
+			slot++;
+		}
+		op_start(&ctx->ops[slot], &ring->sq[head & (URING_ENTRIES - 1u)]);
+		ctx->inflight++;
+		head++;
+		taken++;
+	}
+
+	__asm__ volatile("dmb" ::: "memory");
+	ring->sq_head = head;
+	return taken;
+}
+
+static void uring_progress(uring_ctx_t *ctx, bool from_enter)
+{
+	struct uring *ring = ctx->ring;
+	for (unsigned int i = 0; i < URING_ENTRIES; ++i) {
+		uring_req_t *op = &ctx->ops[i];
+		if (!op->used) {
+			continue;
+		}
+		if (!op->complete) {
+			op_progress(op, from_enter);
+		}
+		// Bei voller Completion Ring bleibt das Ergebnis hier liegen
+		if (!op->complete || cq_ready(ring) >= URING_ENTRIES) {
+			continue;
+		}
+
+		struct uring_cqe *cqe = &ring->cq[ring->cq_tail & (URING_ENTRIES - 1u)];
+		cqe->user_data	      = op->sqe.user_data;
+		cqe->result	      = op->result;
+		__asm__ volatile("dmb" ::: "memory");
+		ring->cq_tail++;
+		op->used = false;
+		ctx->inflight--;
+	}
+}
+
+static uint32_t uring_process(uring_ctx_t *ctx, bool from_enter)
+{
+	uint32_t total = 0u;
+	uint32_t taken;
+	do {
+		taken = uring_take(ctx);
+		uring_progress(ctx, from_enter);
+		total += taken;
+	} while (taken != 0u);
+
+	tcb_t *waiter;
+	while ((waiter = scheduler_first_waiter(&ctx->waiters)) != NULL) {
+		uint32_t wanted = waiter->ctx_storage.r2 < URING_ENTRIES ? waiter->ctx_storage.r2 : URING_ENTRIES;
+		if (cq_ready(ctx->ring) < wanted) {
+			break;
+		}
+		(void)scheduler_wake_first(&ctx->waiters);
+	}
+	return total;
+}
+
+void uring_init(void)
+{
+	for (unsigned int i = 0; i < URING_MAX; ++i) {
+		uring_ctx_t *ctx = &g_uring[i];
+		ctx->ring	 = NULL;
+		ctx->owner	 = NULL;
+		ctx->waiters	 = (list_node){ &ctx->waiters, &ctx->waiters };
+	}
+}
+
+/* Returns the id of the registered ring, or 0 if ring is invalid or all URING_MAX are in use. */
+uint32_t uring_setup(struct uring *ring)
+{
+	if (!user_buffer_valid((uint32_t)ring, sizeof(*ring)) || ((uint32_t)ring & 3u) != 0u) {
+		return 0u;
+	}
+
+	for (unsigned int i = 0; i < URING_MAX; ++i) {
+		uring_ctx_t *ctx = &g_uring[i];
+		if (!ctx->ring) {
+			ctx->ring     = ring;
+			ctx->owner    = g_current;
+			ctx->inflight = 0u;
+			for (unsigned int j = 0; j < URING_ENTRIES; ++j) {
+				ctx->ops[j].used = false;
+			}
+			return i + 1u;
+		}
+	}
+	return 0u;
+}
+
+uring_result_t uring_enter(uint32_t id, uint32_t min_complete, uint32_t *submitted)
+{
+	uring_ctx_t *ctx = uring_get(id);
+	if (!ctx) {
+		return URING_INVALID;
+	}
+
+	*submitted = uring_process(ctx, true);
+	if (min_complete > URING_ENTRIES) {
+		min_complete = URING_ENTRIES;
+	}
+	if (cq_ready(ctx->ring) >= min_complete) {
+		return URING_DONE;
+	}
+
+	if (!scheduler_block_current(&ctx->waiters, T_BLOCKED)) {
+		return URING_INVALID;
+	}
+	return URING_BLOCKED;
+}
+
+void uring_release(uint32_t id)
+{
+	uring_ctx_t *ctx = uring_get(id);
+	if (ctx) {
+		uring_ctx_release(ctx);
+	}
+}
+
+/* Releases the rings of an exiting thread, they usually live on its stack. */
+void uring_thread_exit(const tcb_t *thread)
+{
+	for (unsigned int i = 0; i < URING_MAX; ++i) {
+		if (g_uring[i].ring && g_uring[i].owner == thread) {
+			uring_ctx_release(&g_uring[i]);
+		}
+	}
+}
+
+/* Called from the UART interrupt and the tick, completes whatever became possible. */
+void uring_poll(void)
+{
+	for (unsigned int i = 0; i < URING_MAX; ++i) {
+		if (g_uring[i].ring) {
+			(void)uring_process(&g_uring[i], false);
+		}
+	}
+}
+
+/* Earliest tick a timed request is waiting for, so the tickless timer wakes up for it. */
+bool uring_next_deadline(uint32_t *tick)
+{
+	bool found = false;
+	for (unsigned int i = 0; i < URING_MAX; ++i) {
+		if (!g_uring[i].ring) {
+			continue;
+		}
+		for (unsigned int j = 0; j < URING_ENTRIES; ++j) {
+			const uring_req_t *op = &g_uring[i].ops[j];
+			if (op->used && !op->complete && op->timed &&
+			    (!found || (int32_t)(op->deadline - *tick) < 0)) {
+				*tick = op->deadline;
+				found = true;
+			}
+		}
+	}
+	return found;
+}
@@ -0,0 +1,122 @@
+#include <kernel/vfp.h>
+#include <kernel/scheduler.h>
+#include <kernel/smp.h>
+#include <kernel/kmem.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define FPEXC_EN (1u << 30)
+
+/*
+ * VFP/NEON state is switched lazily. A thread runs with FPEXC.EN off until
+ * its first FP instruction traps into undefined_handler. Only then is the
+ * bank of the previous owner saved and the thread's own bank loaded, so
+ * threads that never touch FP cost nothing on a switch.
+ *
+ * With more than one core a thread may be stolen while its bank still sits
+ * in the registers of its old core. Threads that used FP in their slice are
+ * therefore saved when they are switched out, restoring stays lazy.
+ *
+ * The bank itself is allocated on the first trap as well, so a thread pays
+ * for it only once it uses FP. Without memory left for it the instruction is
+ * treated as undefined.
+ */
+static struct tcb *g_vfp_owner[SMP_CORES];
+static bool g_vfp_enabled[SMP_CORES];
+
+extern void vfp_enable_access_hw(void);
+extern void vfp_set_fpexc_hw(uint32_t fpexc);
+extern void vfp_save_hw(vfp_state_t *state);
+extern void vfp_restore_hw(const vfp_state_t *state);
+
+void vfp_init(void)
+{
+	vfp_enable_access_hw();
+	g_vfp_enabled[smp_cpu_id()] = false;
+}
+
+static void vfp_reset_state(vfp_state_t *state)
+{
+	memset(state->d, 0, sizeof(state->d));
+	state->fpscr = 0u;
+	state->cpu = VFP_NO_CPU;
+}
+
+/* VFP and NEON instructions in ARM state, see ARM ARM A5.7 and A7.4 */
+static bool is_vfp_instruction(uint32_t insn)
+{
+	if ((insn & 0xFE000000u) == 0xF2000000u || (insn & 0xFF100000u) == 0xF4000000u) {
+		return true;
+	}
+
+	uint32_t coproc = (insn >> 8) & 0xFu;
+	return (coproc == 10u || coproc == 11u) && (insn & 0x0C000000u) == 0x0C000000u &&
+	       (insn & 0x0F000000u) != 0x0F000000u;
+}
+
+void vfp_switch(struct tcb *prev, struct tcb *next)
+{
+	(void)next;
+	unsigned int cpu = smp_cpu_id();
+	if (!g_vfp_enabled[cpu]) {
+		return;
+	}
+
+#if SMP_CORES > 1
+	if (prev && g_vfp_owner[cpu] == prev) {
+		vfp_save_hw(prev->vfp);
+	}
+#else
+	(void)prev;
+#endif
+	vfp_set_fpexc_hw(0u);
+	g_vfp_enabled[cpu] = false;
+}
+
+bool vfp_handle_trap(struct context_frame *ctx)
+{
+	unsigned int cpu = smp_cpu_id();
+	struct tcb *current = g_current;
+	if (!current || g_vfp_enabled[cpu] || !is_vfp_instruction(*(const uint32_t *)(ctx->lr_exc - 4u))) {
+		return false;
+	}
+
+	if (!current->vfp) {
+		current->vfp = kmem_alloc(sizeof(vfp_state_t));
+		if (!current->vfp) {
+			return false;
+		}
+		vfp_reset_state(current->vfp);
+	}
+
+	vfp_set_fpexc_hw(FPEXC_EN);
+	g_vfp_enabled[cpu] = true;
+
+	struct tcb *owner = g_vfp_owner[cpu];
+	if (owner == current && current->vfp->cpu == cpu) {
+		return true;
+	}
+
+#if SMP_CORES == 1
+	if (owner) {
+		vfp_save_hw(owner->vfp);
+	}
+#endif
+	vfp_restore_hw(current->vfp);
+	current->vfp->cpu = (uint8_t)cpu;
+	g_vfp_owner[cpu] = current;
+	return true;
+}
+
+void vfp_release(struct tcb *thread)
+{
+	for (unsigned int cpu = 0; cpu < SMP_CORES; ++cpu) {
+		if (g_vfp_owner[cpu] == thread) {
+			g_vfp_owner[cpu] = NULL;
+		}
+	}
+	kmem_free(thread->vfp, sizeof(vfp_state_t));
+	thread->vfp = NULL;
+}
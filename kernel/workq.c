@@ -0,0 +1,87 @@
+#include <kernel/workq.h>
+#include <kernel/msgq.h>
+#include <kernel/scheduler.h>
+#include <kernel/syscall_dispatch.h>
+
+#include <lib/list.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A submit hands its item straight to the longest waiting worker, or queues
+ * it in the ring. When the ring is full the submitter blocks with the item
+ * still in its r2/r3 and a worker that frees a ring entry moves it over.
+ * Blocked workers get the item written to the struct work_item their r2
+ * points to. There is no allocation. Workers are the receivers of the
+ * msgq, submitters its senders.
+ */
+static msgq_t		g_workq[WORKQ_MAX];
+static struct work_item g_workq_items[WORKQ_MAX][WORKQ_DEPTH];
+
+void workq_init(void)
+{
+	for (unsigned int i = 0; i < WORKQ_MAX; ++i) {
+		msgq_init(&g_workq[i], g_workq_items[i], sizeof(struct work_item), WORKQ_DEPTH);
+	}
+}
+
+/* Returns the id of a new queue, or 0 if all WORKQ_MAX are in use. */
+uint32_t workq_create(void)
+{
+	return msgq_create(g_workq, WORKQ_MAX);
+}
+
+workq_result_t workq_submit(uint32_t id, const struct work_item *item)
+{
+	msgq_t *q = msgq_get(g_workq, WORKQ_MAX, id);
+	if (!q || !item->func) {
+		return WORKQ_INVALID;
+	}
+
+	tcb_t *worker = scheduler_wake_first(&q->receivers);
+	if (worker) {
+		*(struct work_item *)worker->ctx_storage.r2 = *item;
+		worker->ctx_storage.r0 = 0u;
+		return WORKQ_DONE;
+	}
+
+	if (!msgq_full(q)) {
+		msgq_push(q, item);
+		return WORKQ_DONE;
+	}
+
+	if (!scheduler_block_current(&q->senders, T_BLOCKED)) {
+		return WORKQ_INVALID;
+	}
+	return WORKQ_BLOCKED;
+}
+
+workq_result_t workq_wait(uint32_t id, struct work_item *out)
+{
+	msgq_t *q = msgq_get(g_workq, WORKQ_MAX, id);
+	if (!q || ((uint32_t)out & 3u) != 0u || !user_buffer_valid((uint32_t)out, sizeof(*out))) {
+		return WORKQ_INVALID;
+	}
+
+	if (q->count == 0u) {
+		if (!scheduler_block_current(&q->receivers, T_BLOCKED)) {
+			return WORKQ_INVALID;
+		}
+		return WORKQ_BLOCKED;
+	}
+
+	msgq_pop(q, out);
+
+	tcb_t *submitter = scheduler_wake_first(&q->senders);
+	if (submitter) {
+		struct work_item item = {
+			.func = (void (*)(void *))submitter->ctx_storage.r2,
+			.arg  = (void *)submitter->ctx_storage.r3,
+		};
+		msgq_push(q, &item);
+		submitter->ctx_storage.r0 = 0u;
+	}
+	return WORKQ_DONE;
+}
@@ -0,0 +1,176 @@
+#include <user/sync.h>
+
+#include <config.h>
+#include <syscall.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Die atomaren Operationen sind volle Barrieren (dmb davor und danach), so
+ * sieht jeder Waiter eine Änderung entweder vor seinem futex_wait, oder der
+ * Änderer sieht ihn als Waiter und weckt ihn.
+ */
+#ifdef BUILD_FOR_QEMU
+static uint32_t atomic_cmpxchg(volatile uint32_t *p, uint32_t old, uint32_t val)
+{
+	uint32_t prev, fail;
+	__asm__ volatile("	dmb\n"
+			 "1:	ldrex	%0, [%2]\n"
+			 "	teq	%0, %3\n"
+			 "	bne	2f\n"
+			 "	strex	%1, %4, [%2]\n"
+			 "	teq	%1, #0\n"
+			 "	bne	1b\n"
+			 "2:	dmb\n"
+			 : "=&r"(prev), "=&r"(fail)
+			 : "r"(p), "r"(old), "r"(val)
+			 : "cc", "memory");
+	return prev;
+}
+
+static uint32_t atomic_xchg(volatile uint32_t *p, uint32_t val)
+{
+	uint32_t prev, fail;
+	__asm__ volatile("	dmb\n"
+			 "1:	ldrex	%0, [%2]\n"
+			 "	strex	%1, %3, [%2]\n"
+			 "	teq	%1, #0\n"
+			 "	bne	1b\n"
+			 "	dmb\n"
+			 : "=&r"(prev), "=&r"(fail)
+			 : "r"(p), "r"(val)
+			 : "cc", "memory");
+	return prev;
+}
+
+static void atomic_add(volatile uint32_t *p, uint32_t delta)
+{
+	uint32_t val, fail;
+	__asm__ volatile("	dmb\n"
+			 "1:	ldrex	%0, [%2]\n"
+			 "	add	%0, %0, %3\n"
+			 "	strex	%1, %0, [%2]\n"
+			 "	teq	%1, #0\n"
+			 "	bne	1b\n"
+			 "	dmb\n"
+			 : "=&r"(val), "=&r"(fail)
+			 : "r"(p), "r"(delta)
+			 : "cc", "memory");
+}
+#else
+// Auf der Hardware würde strex ohne MMU nie gelingen, der Kernel tauscht unter seinem Lock
+static uint32_t atomic_cmpxchg(volatile uint32_t *p, uint32_t old, uint32_t val)
+{
+	return syscall_futex_cmpxchg(p, old, val);
+}
+
+static uint32_t atomic_xchg(volatile uint32_t *p, uint32_t val)
+{
+	uint32_t prev = *p;
+	uint32_t seen;
+	while ((seen = atomic_cmpxchg(p, prev, val)) != prev) {
+		prev = seen;
+	}
+	return prev;
+}
+
+static void atomic_add(volatile uint32_t *p, uint32_t delta)
+{
+	uint32_t prev = *p;
+	uint32_t seen;
+	while ((seen = atomic_cmpxchg(p, prev, prev + delta)) != prev) {
+		prev = seen;
+	}
+}
+#endif // BUILD_FOR_QEMU
+
+void mutex_lock(mutex_t *m)
+{
+	uint32_t c = atomic_cmpxchg(&m->state, 0u, 1u);
+	if (c == 0u) {
+		return;
+	}
+
+	// Umkämpft: auf 2 setzen, damit unlock weckt, und schlafen bis frei
+	if (c != 2u) {
+		c = atomic_xchg(&m->state, 2u);
+	}
+	while (c != 0u) {
+		syscall_futex_wait(&m->state, 2u);
+		c = atomic_xchg(&m->state, 2u);
+	}
+}
+
+bool mutex_trylock(mutex_t *m)
+{
+	return atomic_cmpxchg(&m->state, 0u, 1u) == 0u;
+}
+
+void mutex_unlock(mutex_t *m)
+{
+	if (atomic_xchg(&m->state, 0u) == 2u) {
+		syscall_futex_wake(&m->state, 1u);
+	}
+}
+
+void condvar_wait(condvar_t *cv, mutex_t *m)
+{
+	atomic_add(&cv->waiters, 1u);
+	uint32_t seq = cv->seq;
+	mutex_unlock(m);
+
+	syscall_futex_wait(&cv->seq, seq);
+	atomic_add(&cv->waiters, (uint32_t)-1);
+
+	// Mit anderen Waitern aufgewacht, also gleich als umkämpft sperren
+	while (atomic_xchg(&m->state, 2u) != 0u) {
+		syscall_futex_wait(&m->state, 2u);
+	}
+}
+
+void condvar_signal(condvar_t *cv)
+{
+	atomic_add(&cv->seq, 1u);
+	if (cv->waiters != 0u) {
+		syscall_futex_wake(&cv->seq, 1u);
+	}
+}
+
+void condvar_broadcast(condvar_t *cv)
+{
+	atomic_add(&cv->seq, 1u);
+	if (cv->waiters != 0u) {
+		syscall_futex_wake(&cv->seq, 0xFFFFFFFFu);
+	}
+}
+
+bool sem_trywait(semaphore_t *s)
+{
+	uint32_t v = s->value;
+	while (v != 0u) {
+		uint32_t prev = atomic_cmpxchg(&s->value, v, v - 1u);
+		if (prev == v) {
+			return true;
+		}
+		v = prev;
+	}
+	return false;
+}
+
+void sem_wait(semaphore_t *s)
+{
+	while (!sem_trywait(s)) {
+		atomic_add(&s->waiters, 1u);
+		syscall_futex_wait(&s->value, 0u);
+		atomic_add(&s->waiters, (uint32_t)-1);
+	}
+}
+
+void sem_post(semaphore_t *s)
+{
+	atomic_add(&s->value, 1u);
+	if (s->waiters != 0u) {
+		syscall_futex_wake(&s->value, 1u);
+	}
+}
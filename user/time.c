@@ -0,0 +1,65 @@
+#include <user/time.h>
+
+#include <syscall.h>
+
+#include <stdint.h>
+
+static const struct time_page *g_page;
+
+static const struct time_page *time_page(void)
+{
+	if (!g_page) {
+		g_page = syscall_time_page();
+	}
+	return g_page;
+}
+
+uint64_t time_now_us(void)
+{
+	const struct time_page *page = time_page();
+
+	// chi kann zwischen den Lesezugriffen überlaufen, dann clo neu lesen
+	uint32_t hi = *page->chi;
+	uint32_t lo = *page->clo;
+	if (*page->chi != hi) {
+		hi = *page->chi;
+		lo = *page->clo;
+	}
+	return ((uint64_t)hi << 32) | lo;
+}
+
+uint32_t time_ticks(uint64_t *tick_time_us)
+{
+	const struct time_page *page = time_page();
+	uint32_t		seq, ticks, lo, hi;
+
+	// Seqlock Leseseite, während eines Updates ist seq ungerade
+	do {
+		seq = page->seq;
+		__asm__ volatile("dmb" ::: "memory");
+		ticks = page->ticks;
+		lo    = page->tick_time_lo;
+		hi    = page->tick_time_hi;
+		__asm__ volatile("dmb" ::: "memory");
+	} while ((seq & 1u) != 0u || page->seq != seq);
+
+	if (tick_time_us) {
+		*tick_time_us = ((uint64_t)hi << 32) | lo;
+	}
+	return ticks;
+}
+
+uint32_t time_tick_interval_us(void)
+{
+	return time_page()->timer_interval;
+}
+
+void sleep_us(uint32_t n)
+{
+	sleep_until(time_now_us() + n);
+}
+
+void sleep_until(uint64_t abs_time_us)
+{
+	syscall_sleep_until(abs_time_us);
+}